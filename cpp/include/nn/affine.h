@@ -84,6 +84,26 @@ public:
     }
   }
 
+  // inputs and outputs hold one column per batch entry, so each weight is
+  // loaded once for the whole batch
+  template <Activation act = none, Activation pre = none>
+  void propagate_batch(const float *input_data, float *output_data,
+                       uint32_t batch) const {
+    using ColMatrix = Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic>;
+    constexpr auto activation = (act == same) ? pre : act;
+    const auto input = Eigen::Map<const ColMatrix>(input_data, in_dim, batch);
+    Eigen::Map<ColMatrix> output(output_data, out_dim, batch);
+    output.noalias() = weights * input;
+    output.colwise() += biases;
+    if constexpr (activation == none) {
+      return;
+    } else if constexpr (activation == relu) {
+      output = output.cwiseMax(0.0f);
+    } else {
+      output = output.cwiseMax(0.0f).cwiseMin(1.0f);
+    }
+  }
+
   template <Activation act = none, Activation pre = none>
   void propagate(const float *input_data, const auto *index_data,
                  float *output_data, uint32_t n) const {
@@ -28,6 +28,13 @@ struct MainNet {
   std::vector<float> value_buffer;
   std::vector<float> p1_policy_buffer;
   std::vector<float> p2_policy_buffer;
+  // one column per entry for batched propagation
+  std::vector<float> batch_buffer0;
+  std::vector<float> batch_buffer1;
+  std::vector<float> batch_value_buffer;
+  std::vector<float> batch_values;
+  std::vector<float> batch_p1_policy_buffer;
+  std::vector<float> batch_p2_policy_buffer;
 
   std::tuple<int, int, int, int> shape() const noexcept {
     return {fc0.in_dim, fc0.out_dim, value_fc2.out_dim, p1_policy_fc2.out_dim};
@@ -105,6 +112,60 @@ struct MainNet {
       return output;
     }
   }
+
+  // batched version of the above. entries provide m, n and the logit outputs
+  // and receive the value logit. there are 9 choice indices per entry
+  template <bool use_value, bool use_policy, Activation activation>
+  void propagate_batch(const float *input_data, const uint32_t batch,
+                       auto *entries, const auto *p1_choice_index,
+                       const auto *p2_choice_index) {
+    const auto resize = [batch](auto &buffer, const auto &layer) {
+      buffer.resize(layer.out_dim * batch);
+    };
+    resize(batch_buffer0, fc0);
+    resize(batch_buffer1, fc1);
+    fc0.propagate_batch<activation>(input_data, batch_buffer0.data(), batch);
+    fc1.propagate_batch<activation>(batch_buffer0.data(), batch_buffer1.data(),
+                                    batch);
+    if constexpr (use_value) {
+      resize(batch_value_buffer, value_fc2);
+      resize(batch_values, value_fc3);
+      value_fc2.propagate_batch<activation>(
+          batch_buffer1.data(), batch_value_buffer.data(), batch);
+      value_fc3.propagate_batch<>(batch_value_buffer.data(),
+                                  batch_values.data(), batch);
+      for (uint32_t b = 0; b < batch; ++b) {
+        entries[b].value = batch_values[b];
+      }
+    }
+    if constexpr (use_policy) {
+      resize(batch_p1_policy_buffer, p1_policy_fc2);
+      resize(batch_p2_policy_buffer, p2_policy_fc2);
+      p1_policy_fc2.propagate_batch<activation>(
+          batch_buffer1.data(), batch_p1_policy_buffer.data(), batch);
+      p2_policy_fc2.propagate_batch<activation>(
+          batch_buffer1.data(), batch_p2_policy_buffer.data(), batch);
+      const auto logits = [](const auto &fc3, const float *buffer,
+                             const auto *index, const int k, float *out) {
+        const auto hidden =
+            Eigen::Map<const Eigen::VectorXf>(buffer, fc3.in_dim);
+        for (auto i = 0; i < k; ++i) {
+          assert(index[i] < Encode::Battle::Policy::n_dim);
+          out[i] = fc3.weights.row(index[i]).dot(hidden) + fc3.biases[index[i]];
+          assert(!std::isnan(out[i]));
+        }
+      };
+      for (uint32_t b = 0; b < batch; ++b) {
+        auto &entry = entries[b];
+        logits(p1_policy_fc3,
+               batch_p1_policy_buffer.data() + b * p1_policy_fc3.in_dim,
+               p1_choice_index + 9 * b, entry.m, entry.p1_logits);
+        logits(p2_policy_fc3,
+               batch_p2_policy_buffer.data() + b * p2_policy_fc3.in_dim,
+               p2_choice_index + 9 * b, entry.n, entry.p2_logits);
+      }
+    }
+  }
 };
 
 // struct MainNetHalf {
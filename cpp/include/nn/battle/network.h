@@ -9,13 +9,30 @@
 #include <nn/ffn.h>
 #include <util/random.h>
 
+#include <span>
+
 namespace NN::Battle {
 
 inline constexpr float sigmoid(const float x) { return 1 / (1 + std::exp(-x)); }
 
+// one position of a batched inference. the logits are only written when the
+// policy is requested
+struct BatchEntry {
+  const pkmn_gen1_battle *battle;
+  const pkmn_gen1_chance_durations *durations;
+  int m;
+  int n;
+  const pkmn_choice *p1_choices;
+  const pkmn_choice *p2_choices;
+  float *p1_logits;
+  float *p2_logits;
+  float value;
+};
+
 struct NetworkBase {
   virtual std::tuple<int, int, int, int> shape() const noexcept = 0;
   virtual std::unique_ptr<NetworkBase> clone() const noexcept = 0;
+  virtual void fill_cache(const pkmn_gen1_battle &battle) noexcept = 0;
   virtual ~NetworkBase() = default;
 };
 
@@ -29,12 +46,18 @@ public:
   EmbeddingNet pokemon_net;
   EmbeddingNet active_net;
   BattleCache<T> battle_cache;
+  // bumped by fill_cache, so that copies can tell their cache is stale
+  uint64_t cache_version = 0;
   Main main_net;
 
   uint32_t pokemon_out_dim;
   uint32_t active_out_dim;
   uint32_t side_embedding_dim;
   std::vector<T> battle_embedding;
+  // scratch for batched inference
+  std::vector<T> batch_embedding;
+  std::vector<uint16_t> batch_p1_choice_index;
+  std::vector<uint16_t> batch_p2_choice_index;
 
 public:
   std::tuple<int, int, int, int> shape() const noexcept {
@@ -47,6 +70,7 @@ public:
 
   void fill_cache(const pkmn_gen1_battle &battle) noexcept {
     battle_cache.template fill<activation>(pokemon_net, PKMN::view(battle));
+    ++cache_version;
   }
 
   bool read_parameters(std::istream &stream) {
@@ -122,7 +146,48 @@ public:
     return value;
   }
 
+  // batched versions of value_inference and value_policy_inference
+  void value_inference(std::span<BatchEntry> entries) {
+    batch_inference<false>(entries);
+  }
+
+  void value_policy_inference(std::span<BatchEntry> entries) {
+    batch_inference<true>(entries);
+  }
+
 private:
+  template <bool use_policy>
+  void batch_inference(std::span<BatchEntry> entries) {
+    const auto batch = entries.size();
+    const auto dim = battle_embedding.size();
+    batch_embedding.resize(batch * dim);
+    batch_p1_choice_index.resize(batch * 9);
+    batch_p2_choice_index.resize(batch * 9);
+    for (size_t b = 0; b < batch; ++b) {
+      const auto &entry = entries[b];
+      if constexpr (use_policy) {
+        const auto &battle = PKMN::view(*entry.battle);
+        for (auto i = 0; i < entry.m; ++i) {
+          batch_p1_choice_index[9 * b + i] = Encode::Battle::Policy::get_index(
+              battle.sides[0], entry.p1_choices[i]);
+        }
+        for (auto i = 0; i < entry.n; ++i) {
+          batch_p2_choice_index[9 * b + i] = Encode::Battle::Policy::get_index(
+              battle.sides[1], entry.p2_choices[i]);
+        }
+      }
+      write_battle_embedding(*entry.battle, *entry.durations,
+                             batch_embedding.data() + b * dim);
+    }
+    main_net.template propagate_batch<true, use_policy, activation>(
+        batch_embedding.data(), batch, entries.data(),
+        batch_p1_choice_index.data(), batch_p2_choice_index.data());
+    for (auto &entry : entries) {
+      entry.value = sigmoid(entry.value);
+      assert(!std::isnan(entry.value));
+    }
+  }
+
   auto side_embedding_index(auto i) const noexcept {
     assert(i > 0);
     return (1 + active_out_dim) + (i - 1) * (1 + pokemon_out_dim);
@@ -130,6 +195,12 @@ private:
 
   void write_battle_embedding(const pkmn_gen1_battle &b,
                               const pkmn_gen1_chance_durations &d) noexcept {
+    write_battle_embedding(b, d, battle_embedding.data());
+  }
+
+  void write_battle_embedding(const pkmn_gen1_battle &b,
+                              const pkmn_gen1_chance_durations &d,
+                              T *output) noexcept {
     const auto &battle = PKMN::view(b);
     const auto &durations = PKMN::view(d);
     for (auto s = 0; s < 2; ++s) {
@@ -137,8 +208,7 @@ private:
       const auto &duration = durations.get(s);
       const auto &stored = side.stored();
 
-      auto *side_embedding =
-          battle_embedding.data() + s * side_embedding_index(6);
+      auto *side_embedding = output + s * side_embedding_index(6);
 
       if (stored.hp == 0) {
         std::fill_n(side_embedding, active_out_dim + 1, 0);
@@ -6,6 +6,7 @@
 #include <iosfwd>
 #include <memory>
 #include <type_traits>
+#include <vector>
 
 #include <nn/affine.h>
 #include <nn/battle/quantized/affine.h>
@@ -148,6 +149,69 @@ struct MainNet {
       return value;
     }
   }
+
+  // batched version of the above. each layer runs over the whole batch before
+  // the next one so its weights stay in cache. entries provide m, n and the
+  // logit outputs and receive the value. there are 9 choice indices per entry
+  template <bool use_value, bool use_policy, Activation activation>
+  void propagate_batch(const uint8_t *input_data, const uint32_t batch,
+                       auto *entries, const auto *p1_choice_index,
+                       const auto *p2_choice_index) const {
+    static_assert(activation == Activation::clamp);
+    constexpr float conversion = 127 * (1 << 6);
+    static thread_local std::vector<ValuePolicyBuffer> buffers;
+    if (buffers.size() < batch) {
+      buffers.resize(batch);
+    }
+    const auto layer = [&](const auto &f) {
+      for (uint32_t b = 0; b < batch; ++b) {
+        f(buffers[b], b);
+      }
+    };
+    layer([&](auto &buf, auto b) {
+      fc0.propagate(input_data + b * In, buf.fc0_out);
+    });
+    layer([&](auto &buf, auto) { ac0.propagate(buf.fc0_out, buf.ac0_out); });
+    layer([&](auto &buf, auto) { fc1.propagate(buf.ac0_out, buf.fc1_out); });
+    layer([&](auto &buf, auto) { ac1.propagate(buf.fc1_out, buf.ac1_out); });
+    if constexpr (use_value) {
+      layer([&](auto &buf, auto) {
+        value_fc2.propagate(buf.ac1_out, buf.value_fc2_out);
+      });
+      layer([&](auto &buf, auto) {
+        value_ac2.propagate(buf.value_fc2_out, buf.value_ac2_out);
+      });
+      layer([&](auto &buf, auto b) {
+        value_fc3.propagate(buf.value_ac2_out, buf.value_fc3_out);
+        entries[b].value = buf.value_fc3_out[0] / conversion;
+      });
+    }
+    if constexpr (use_policy) {
+      layer([&](auto &buf, auto) {
+        p1_policy_fc2.propagate(buf.ac1_out, buf.p1_policy_fc2_out);
+        p1_policy_ac2.propagate(buf.p1_policy_fc2_out, buf.p1_policy_ac2_out);
+      });
+      layer([&](auto &buf, auto) {
+        p2_policy_fc2.propagate(buf.ac1_out, buf.p2_policy_fc2_out);
+        p2_policy_ac2.propagate(buf.p2_policy_fc2_out, buf.p2_policy_ac2_out);
+      });
+      layer([&](auto &buf, auto b) {
+        auto &entry = entries[b];
+        for (int i = 0; i < entry.m; ++i) {
+          entry.p1_logits[i] =
+              p1_policy_fc3.propagate_single(buf.p1_policy_ac2_out,
+                                             p1_choice_index[9 * b + i]) /
+              conversion;
+        }
+        for (int i = 0; i < entry.n; ++i) {
+          entry.p2_logits[i] =
+              p2_policy_fc3.propagate_single(buf.p2_policy_ac2_out,
+                                             p2_choice_index[9 * b + i]) /
+              conversion;
+        }
+      });
+    }
+  }
 };
 
 } // namespace NN::Battle::Quantized
\ No newline at end of file
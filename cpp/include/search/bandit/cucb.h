@@ -0,0 +1,118 @@
+#pragma once
+
+#include <search/joint.h>
+#include <search/util/int.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+// UCB with compact stats: the mean value of each arm as 24 bit fixed point and
+// 16 bit visits. the selection is the same as UCB, which keeps the value sums
+namespace CUCB {
+
+#pragma pack(push, 1)
+struct Bandit {
+
+  struct Params {
+    float c;
+  };
+
+  struct Outcome {
+    float value;
+    uint8_t index;
+  };
+
+  static constexpr float q_scale = (1 << 24) - 1;
+  static constexpr uint16_t max_visits = std::numeric_limits<uint16_t>::max();
+
+  std::array<uint24_t, 9> q;
+  std::array<uint16_t, 9> visits;
+  // sum of visits
+  uint24_t n;
+  // virtual losses not yet replaced by virtual_update, saturating
+  uint8_t pending;
+  uint8_t k;
+
+  void init(const auto k) noexcept {
+    this->k = k;
+    n = k;
+    pending = 0;
+    std::fill(q.begin(), q.begin() + k, uint24_t{1 << 23});
+    std::fill(visits.begin(), visits.begin() + k, 1);
+  }
+
+  bool is_init() const noexcept { return k; }
+
+  float mean(const uint8_t i) const noexcept { return q[i] / q_scale; }
+
+  void set_mean(const uint8_t i, const float x) noexcept {
+    q[i] = std::lround(std::clamp(x, 0.f, 1.f) * q_scale);
+  }
+
+  // halve all the visits when one would overflow. the means are kept, so this
+  // only makes the bandit explore as if it had fewer samples. virtual_update
+  // divides by the visits, so while virtual losses are pending the visits
+  // stay at the maximum instead and the mean becomes a moving average
+  void count(const uint8_t index) noexcept {
+    if (visits[index] == max_visits) {
+      if (pending) {
+        return;
+      }
+      n = 0;
+      for (auto i = 0; i < k; ++i) {
+        visits[i] = std::max(visits[i] / 2, 1);
+        n = n + visits[i];
+      }
+    }
+    ++visits[index];
+    ++n;
+  }
+
+  void update(const auto &outcome) noexcept {
+    const auto i = outcome.index;
+    count(i);
+    set_mean(i, mean(i) + (outcome.value - mean(i)) / visits[i]);
+  }
+
+  // a visit with value 0 until virtual_update adds the real value
+  void virtual_loss(const auto &outcome) noexcept {
+    const auto i = outcome.index;
+    count(i);
+    set_mean(i, mean(i) * (visits[i] - 1) / visits[i]);
+    pending += (pending < std::numeric_limits<uint8_t>::max());
+  }
+
+  void virtual_update(const auto &outcome) noexcept {
+    const auto i = outcome.index;
+    set_mean(i, mean(i) + outcome.value / visits[i]);
+    pending -= (pending > 0);
+  }
+
+  void select([[maybe_unused]] auto &device, const Params &params,
+              auto &outcome) const noexcept {
+    // also the pick if no arm scores above 0
+    outcome.index = 0;
+    if (k > 1) {
+      const float e = params.c * std::sqrt(float(n)) / k;
+      float max = 0;
+      for (auto i = 0; i < k; ++i) {
+        const float a = mean(i) + e / visits[i];
+        if (a > max) {
+          max = a;
+          outcome.index = i;
+        }
+      }
+    }
+  }
+};
+#pragma pack(pop)
+
+using JointBandit = Joint<Bandit>;
+
+static_assert(sizeof(JointBandit) == 100);
+
+}; // namespace CUCB
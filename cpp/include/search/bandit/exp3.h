@@ -51,13 +51,17 @@ struct Bandit {
     } else {
       const float eta{params.gamma / k};
       const float delta{params.alpha / k};
-      softmax(policy, gains, eta);
-      std::transform(policy.begin(), policy.end(), policy.begin(),
-                     [eta, delta, &params](const float x) {
-                       return params.one_minus_alpha * x + delta;
-                     });
-      outcome.index = std::min(static_cast<uint8_t>(device.sample_pdf(policy)),
-                               static_cast<uint8_t>(k - 1));
+      exp3_policy(policy, gains, eta, params.one_minus_alpha, delta);
+      // the first k probs sum to 1, up to rounding which goes to the last
+      float p = device.uniform_float();
+      outcome.index = k - 1;
+      for (uint8_t i = 0; i < k - 1; ++i) {
+        p -= policy[i];
+        if (p < 0) {
+          outcome.index = i;
+          break;
+        }
+      }
       outcome.prob = policy[outcome.index];
     }
   }
@@ -70,6 +74,20 @@ struct Bandit {
       }
     }
   }
+
+  // same as an update with value 0. the shift in update commutes with this
+  void virtual_loss(const auto &outcome) noexcept {
+    gains[outcome.index] -= 0.5f / outcome.prob;
+  }
+
+  void virtual_update(const auto &outcome) noexcept {
+    if ((gains[outcome.index] += outcome.value / outcome.prob) > 0) {
+      const auto max = gains[outcome.index];
+      for (auto &v : gains) {
+        v -= max;
+      }
+    }
+  }
 };
 #pragma pack(pop)
 
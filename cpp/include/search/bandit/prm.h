@@ -0,0 +1,117 @@
+#pragma once
+
+#include <search/joint.h>
+#include <search/util/softmax.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+
+// Predictive regret matching+ with priors. The policy is proportional to the
+// clamped sum of the regrets and a prediction of the next instantaneous regret,
+// which is the last one. The regrets start as the weighted priors. see RM
+namespace PRM {
+
+#pragma pack(push, 1)
+struct Bandit {
+
+  struct Outcome {
+    float value;
+    float prob;
+    float policy;
+    uint8_t index;
+  };
+
+  struct Params {
+    float gamma;
+    float one_minus_gamma;
+    // total regret the priors are worth
+    float prior_weight;
+  };
+
+  std::array<float, 9> regrets;
+  std::array<float, 9> prediction;
+  uint8_t k;
+
+  void init(const auto k) noexcept {
+    this->k = k;
+    std::fill(regrets.begin(), regrets.end(), 0);
+    std::fill(prediction.begin(), prediction.end(), 0);
+  }
+
+  bool is_init() const noexcept { return k; }
+
+  void softmax_logits(const Params &params, const float *logits) noexcept {
+    softmax(regrets.data(), logits, k);
+    for (auto i = 0; i < k; ++i) {
+      regrets[i] *= params.prior_weight;
+    }
+  }
+
+  void select(auto &device, const Params &params,
+              auto &outcome) const noexcept {
+    if (k == 1) {
+      outcome.index = 0;
+      outcome.prob = 1;
+      outcome.policy = 1;
+      return;
+    }
+    // regrets and predictions past k are always 0
+    std::array<float, 9> weights;
+    float sum = 0;
+    for (auto i = 0; i < 9; ++i) {
+      weights[i] = std::max(regrets[i] + prediction[i], 0.f);
+      sum += weights[i];
+    }
+    const float uniform = 1.f / k;
+    const float scale = (sum > 0) ? 1 / sum : 0;
+    const float p_scale = params.one_minus_gamma * scale;
+    const float p_uniform = (sum > 0) ? params.gamma * uniform : uniform;
+
+    float p = device.uniform_float();
+    outcome.index = k - 1;
+    for (uint8_t i = 0; i < k - 1; ++i) {
+      p -= weights[i] * p_scale + p_uniform;
+      if (p < 0) {
+        outcome.index = i;
+        break;
+      }
+    }
+    outcome.prob = weights[outcome.index] * p_scale + p_uniform;
+    outcome.policy = (sum > 0) ? weights[outcome.index] * scale : uniform;
+  }
+
+  // adds the instantaneous regret to the prediction when 'predict' is false
+  void accumulate(const auto &outcome, const float g,
+                  const bool predict) noexcept {
+    const float baseline = g * outcome.policy;
+    for (auto i = 0; i < k; ++i) {
+      const float r = ((i == outcome.index) ? g : 0) - baseline;
+      regrets[i] = std::max(regrets[i] + r, 0.f);
+      prediction[i] = predict ? r : prediction[i] + r;
+    }
+  }
+
+  void update(const auto &outcome) noexcept {
+    accumulate(outcome, (outcome.value - .5f) / outcome.prob, true);
+  }
+
+  // same as an update with value 0. virtual_update adds the rest of the
+  // instantaneous regret to the prediction
+  void virtual_loss(const auto &outcome) noexcept {
+    accumulate(outcome, -.5f / outcome.prob, true);
+  }
+
+  void virtual_update(const auto &outcome) noexcept {
+    accumulate(outcome, outcome.value / outcome.prob, false);
+  }
+};
+#pragma pack(pop)
+
+using JointBandit = Joint<Bandit>;
+
+static_assert(sizeof(JointBandit) == 146);
+
+}; // namespace PRM
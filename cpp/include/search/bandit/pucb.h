@@ -3,6 +3,7 @@
 #pragma once
 
 #include <search/joint.h>
+#include <search/util/argmax.h>
 #include <search/util/int.h>
 #include <search/util/softmax.h>
 
@@ -11,6 +12,7 @@
 #include <cassert>
 #include <cmath>
 #include <cstdint>
+#include <iostream>
 
 namespace PUCB {
 
@@ -29,10 +31,13 @@ struct Bandit {
   std::array<float, 9> scores;
   std::array<float, 9> priors;
   std::array<uint32_t, 9> visits;
+  // sum of visits
+  uint32_t n;
   uint8_t k;
 
   void init(const auto k) noexcept {
     this->k = k;
+    n = k;
     std::fill(scores.begin(), scores.begin() + k, 0.5);
     std::fill(visits.begin(), visits.begin() + k, 1);
   }
@@ -46,27 +51,28 @@ struct Bandit {
   void update(const auto &outcome) noexcept {
     scores[outcome.index] += outcome.value;
     ++visits[outcome.index];
+    ++n;
   }
 
-  void select(auto &device, const Params &params,
+  void virtual_loss(const auto &outcome) noexcept {
+    ++visits[outcome.index];
+    ++n;
+  }
+
+  void virtual_update(const auto &outcome) noexcept {
+    scores[outcome.index] += outcome.value;
+  }
+
+  void select([[maybe_unused]] auto &device, const Params &params,
               auto &outcome) const noexcept {
     if (k == 1) {
       outcome.index = 0;
     } else {
-      uint64_t N = 0;
-      for (auto i = 0; i < k; ++i) {
-        N += visits[i];
-      }
-      float sqrtN = std::sqrt(N);
-      float max = 0;
-      for (auto i = 0; i < k; ++i) {
-        float e = params.c * priors[i] * sqrtN;
-        float a = (e + scores[i]) / visits[i];
-        if (a > max) {
-          max = a;
-          outcome.index = i;
-        }
-      }
+      const float c_sqrtN = params.c * std::sqrt(float(n));
+      const __m256 e = _mm256_mul_ps(_mm256_loadu_ps(priors.data()),
+                                     _mm256_set1_ps(c_sqrtN));
+      outcome.index = ucb_argmax(scores.data(), visits.data(), e,
+                                 priors[8] * c_sqrtN, k);
     }
   }
 
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <search/joint.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+
+// Regret matching+ with bandit feedback. The payoff of the selected arm is
+// importance weighted, the regrets are clamped at 0 after every update and the
+// policy is proportional to them, mixed with gamma uniform exploration
+namespace RM {
+
+#pragma pack(push, 1)
+struct Bandit {
+
+  struct Outcome {
+    float value;
+    // probability of the index under the explored and regret matching policy
+    float prob;
+    float policy;
+    uint8_t index;
+  };
+
+  struct Params {
+    float gamma;
+    float one_minus_gamma;
+  };
+
+  std::array<float, 9> regrets;
+  uint8_t k;
+
+  void init(const auto k) noexcept {
+    this->k = k;
+    std::fill(regrets.begin(), regrets.end(), 0);
+  }
+
+  bool is_init() const noexcept { return k; }
+
+  void select(auto &device, const Params &params,
+              auto &outcome) const noexcept {
+    if (k == 1) {
+      outcome.index = 0;
+      outcome.prob = 1;
+      outcome.policy = 1;
+      return;
+    }
+    // regrets past k are always 0
+    float sum = 0;
+    for (auto i = 0; i < 9; ++i) {
+      sum += regrets[i];
+    }
+    const float uniform = 1.f / k;
+    const float scale = (sum > 0) ? 1 / sum : 0;
+    const float p_scale = params.one_minus_gamma * scale;
+    const float p_uniform = (sum > 0) ? params.gamma * uniform : uniform;
+
+    float p = device.uniform_float();
+    outcome.index = k - 1;
+    for (uint8_t i = 0; i < k - 1; ++i) {
+      p -= regrets[i] * p_scale + p_uniform;
+      if (p < 0) {
+        outcome.index = i;
+        break;
+      }
+    }
+    outcome.prob = regrets[outcome.index] * p_scale + p_uniform;
+    outcome.policy = (sum > 0) ? regrets[outcome.index] * scale : uniform;
+  }
+
+  // the estimated payoff is g for the index and 0 for the other arms, so their
+  // regret is -g * policy and the index's is g * (1 - policy)
+  void accumulate(const auto &outcome, const float g) noexcept {
+    const float baseline = g * outcome.policy;
+    regrets[outcome.index] += g;
+    for (auto i = 0; i < k; ++i) {
+      regrets[i] = std::max(regrets[i] - baseline, 0.f);
+    }
+  }
+
+  void update(const auto &outcome) noexcept {
+    accumulate(outcome, (outcome.value - .5f) / outcome.prob);
+  }
+
+  // same as an update with value 0. the clamp does not commute with the later
+  // virtual_update, so the pair only approximates an update
+  void virtual_loss(const auto &outcome) noexcept {
+    accumulate(outcome, -.5f / outcome.prob);
+  }
+
+  void virtual_update(const auto &outcome) noexcept {
+    accumulate(outcome, outcome.value / outcome.prob);
+  }
+};
+#pragma pack(pop)
+
+using JointBandit = Joint<Bandit>;
+
+static_assert(sizeof(JointBandit) == 74);
+
+}; // namespace RM
@@ -42,6 +42,12 @@ struct Bandit {
     ++visits[outcome.index];
   }
 
+  void virtual_loss(const auto &outcome) noexcept { ++visits[outcome.index]; }
+
+  void virtual_update(const auto &outcome) noexcept {
+    scores[outcome.index] += outcome.value;
+  }
+
   void select(auto &device, const Params &params,
               auto &outcome) const noexcept {
     if (k == 1) {
@@ -33,6 +33,18 @@ template <typename Bandit> struct Joint {
     p2.update(outcome.p2);
   }
 
+  // shared search: count the selection as a loss until its value is known
+  void virtual_loss(const JointOutcome &outcome) noexcept {
+    p1.virtual_loss(outcome.p1);
+    p2.virtual_loss(outcome.p2);
+  }
+
+  // replace the virtual loss with the real value
+  void virtual_update(const JointOutcome &outcome) noexcept {
+    p1.virtual_update(outcome.p1);
+    p2.virtual_update(outcome.p2);
+  }
+
   void softmax_logits(const Params &params, const float *p1_priors,
                       const float *p2_priors) noexcept
     requires requires(const float *ptr) {
@@ -6,20 +6,49 @@
 #include <search/durations.h>
 #include <search/hash.h>
 #include <search/poke-engine-evaluate.h>
+#include <search/util/arena.h>
+#include <search/util/beta.h>
+#include <search/util/nash.h>
 #include <search/util/softmax.h>
+#include <search/util/spinlock.h>
+#include <search/util/triple-buffer.h>
 #include <util/random.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <cmath>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <random>
+#include <thread>
+#include <tuple>
 #include <type_traits>
-#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "../extern/lrsnash/src/lib.h"
 
 namespace MCTS {
-struct MonteCarlo {};
+// rollout evaluation, set from the mc eval string
+struct MonteCarlo {
+  enum class Policy : uint8_t {
+    uniform,
+    // most damaging move by base power, type effectiveness and stab
+    greedy,
+  };
+  Policy policy = Policy::uniform;
+  // updates played before the rollout is cut off and scored by the poke
+  // engine eval, 0 to play until the battle ends
+  size_t turns = 0;
+  // rollouts averaged per leaf
+  size_t rollouts = 1;
+  PokeEngine::Eval engine{};
+};
 } // namespace MCTS
 
 namespace TypeTraits {
@@ -29,7 +58,11 @@ inline constexpr bool is_node =
 
 template <typename T>
 inline constexpr bool is_table =
-    requires(std::remove_cvref_t<T> &heap) { heap.entries; };
+    requires(std::remove_cvref_t<T> &heap) { heap.hasher; };
+
+template <typename T>
+inline constexpr bool is_shared_table =
+    requires(std::remove_cvref_t<T> &heap) { heap.table; };
 
 template <typename T>
 inline constexpr bool is_network =
@@ -65,6 +98,16 @@ struct Input {
   pkmn_result result;
 };
 
+// time budgets are measured against this clock
+using Clock = std::chrono::steady_clock;
+
+// why a search ended, see EarlyStop
+enum class Stop : uint8_t {
+  budget,
+  lead,
+  nash,
+};
+
 struct Output {
   struct Side {
     uint8_t k;
@@ -81,6 +124,13 @@ struct Output {
 
   size_t iterations;
   std::chrono::microseconds duration;
+  Stop stop;
+  // size of the tree heap after the search, 0 nodes for tables
+  size_t nodes;
+  size_t bytes;
+  // table probes, and those that found an entry from an earlier generation
+  size_t probes;
+  size_t reused;
 
   double initial_value;
   double empirical_value;
@@ -89,19 +139,470 @@ struct Output {
   Side p2;
 };
 
-// for std::map compatibility
+// chance actions of an update, distinguishes children with the same actions
 using Obs = std::array<uint8_t, 16>;
 
+// bandit stats with the legal choices of their state, filled when the stats
+// are initialized so that selecting through them needs no choice generation
+#pragma pack(push, 1)
+template <typename JointBandit> struct Entry : JointBandit {
+  std::array<pkmn_choice, 9> p1_choices;
+  std::array<pkmn_choice, 9> p2_choices;
+
+  void init_choices(const pkmn_choice *p1, const auto m,
+                    const pkmn_choice *p2, const auto n) noexcept {
+    std::copy_n(p1, m, p1_choices.data());
+    std::copy_n(p2, n, p2_choices.data());
+  }
+};
+#pragma pack(pop)
+
 template <typename JointBandit> struct Node {
-  using Key = std::tuple<uint8_t, uint8_t, Obs>;
-  JointBandit stats;
-  std::map<Key, Node<JointBandit>> children;
+  using Bandit = JointBandit;
+  using Stats = Entry<JointBandit>;
+  struct Key {
+    uint8_t p1;
+    uint8_t p2;
+    Obs obs;
+    constexpr auto operator<=>(const Key &) const = default;
+  };
+  // nodes are allocated one at a time and never move, so references to them
+  // stay valid when their siblings are added
+  struct Child {
+    Key key;
+    Node *node;
+  };
+
+  Stats stats;
+  // sorted by key, allocated from the arena of the tree
+  Child *children;
+  uint32_t n_children;
+  uint32_t capacity;
+  // descents that reached this node. never more than the parent's
+  uint32_t visits;
+
+  const Node *find(const Key &key) const noexcept {
+    const auto *it = lower_bound(key);
+    return (it != children + n_children && it->key == key) ? it->node
+                                                           : nullptr;
+  }
+
+  Node *find(const Key &key) noexcept {
+    return const_cast<Node *>(std::as_const(*this).find(key));
+  }
+
+  // returns the child for key, inserting an empty one if needed. growing
+  // moves the child array to a new block and abandons the old one
+  Node &child(const Key &key, Arena &arena) {
+    auto *end = children + n_children;
+    auto *it = lower_bound(key);
+    if (it != end && it->key == key) {
+      return *it->node;
+    }
+    const auto index = it - children;
+    if (n_children == capacity) {
+      capacity = capacity ? 2 * capacity : 2;
+      auto *data = arena.allocate<Child>(capacity);
+      std::copy(children, it, data);
+      std::copy(it, end, data + index + 1);
+      children = data;
+    } else {
+      std::copy_backward(it, end, end + 1);
+    }
+    ++n_children;
+    auto *node = arena.allocate<Node>(1);
+    *node = {};
+    children[index] = {key, node};
+    return *node;
+  }
+
+private:
+  Child *lower_bound(const Key &key) const noexcept {
+    return std::lower_bound(
+        children, children + n_children, key,
+        [](const Child &child, const Key &key) { return child.key < key; });
+  }
+};
+
+// root of a search tree. all nodes below are allocated from its arena so
+// dropping the tree frees them together
+template <typename JointBandit> struct Tree : Node<JointBandit> {
+  using Child = typename Node<JointBandit>::Child;
+
+  Arena arena;
+  // nodes including the root
+  size_t size;
+  // arena bytes after the last prune
+  size_t pruned_bytes = 0;
+
+  Tree() : Node<JointBandit>{}, arena{}, size{1} {}
+  Tree(Tree &&) = default;
+  Tree &operator=(Tree &&) = default;
+
+  // make the child the new root. nodes that are no longer reachable are kept
+  // in the arena until the next prune, and size is stale until then
+  bool reroot(const typename Node<JointBandit>::Key &key) noexcept {
+    const auto *child = this->find(key);
+    if (!child) {
+      return false;
+    }
+    static_cast<Node<JointBandit> &>(*this) = *child;
+    return true;
+  }
+
+  // frees the unreachable nodes once the arena has doubled since the last
+  // prune, so a reroot stays O(1) and the copies are amortized over the
+  // allocations
+  void compact() {
+    if (arena.allocated >= 2 * std::max(pruned_bytes, Arena::block_size)) {
+      prune();
+    }
+  }
+
+  // copy the tree into a new arena, keeping only the most visited nodes that
+  // fit in bytes. since a child never has more visits than its parent, the
+  // kept nodes are still connected to the root. with the default limit this
+  // just frees the nodes that are no longer reachable
+  void prune(const size_t bytes = std::numeric_limits<size_t>::max()) {
+    using N = Node<JointBandit>;
+    constexpr size_t node_bytes = sizeof(N) + sizeof(Child);
+
+    std::vector<uint32_t> visits;
+    std::vector<N *> stack{this};
+    while (!stack.empty()) {
+      const auto *node = stack.back();
+      stack.pop_back();
+      for (uint32_t i = 0; i < node->n_children; ++i) {
+        visits.push_back(node->children[i].node->visits);
+        stack.push_back(node->children[i].node);
+      }
+    }
+    // keep visits > threshold, unless everything fits
+    const size_t limit = bytes / node_bytes;
+    const bool all = visits.size() <= limit;
+    uint32_t threshold = 0;
+    if (!all) {
+      std::nth_element(visits.begin(), visits.begin() + limit, visits.end(),
+                       std::greater<>{});
+      threshold = visits[limit];
+    }
+    const auto keep = [all, threshold](const N *node) {
+      return all || node->visits > threshold;
+    };
+
+    // copies still point to the old children until they are popped
+    Arena fresh;
+    size = 1;
+    stack.push_back(this);
+    while (!stack.empty()) {
+      auto *node = stack.back();
+      stack.pop_back();
+      const auto *old = node->children;
+      uint32_t k = 0;
+      for (uint32_t i = 0; i < node->n_children; ++i) {
+        k += keep(old[i].node);
+      }
+      auto *children = k ? fresh.allocate<Child>(k) : nullptr;
+      for (uint32_t i = 0, j = 0; i < node->n_children; ++i) {
+        if (keep(old[i].node)) {
+          auto *copy = fresh.allocate<N>(1);
+          *copy = *old[i].node;
+          children[j++] = {old[i].key, copy};
+          stack.push_back(copy);
+        }
+      }
+      node->children = children;
+      node->n_children = node->capacity = k;
+      size += k;
+    }
+    arena = std::move(fresh);
+    pruned_bytes = arena.allocated;
+  }
+
+  // nodes in depth first order, each followed by the keys of its children.
+  // the stats are written as is, so the file is only valid for the same
+  // bandit and for a search from the same root
+  void write(std::ostream &stream) const {
+    using N = Node<JointBandit>;
+    const uint64_t header[3]{size, sizeof(N), sizeof(typename N::Key)};
+    stream.write(reinterpret_cast<const char *>(header), sizeof(header));
+    std::vector<const N *> stack{this};
+    while (!stack.empty()) {
+      const auto *node = stack.back();
+      stack.pop_back();
+      stream.write(reinterpret_cast<const char *>(&node->stats),
+                   sizeof(node->stats));
+      stream.write(reinterpret_cast<const char *>(&node->visits),
+                   sizeof(node->visits));
+      stream.write(reinterpret_cast<const char *>(&node->n_children),
+                   sizeof(node->n_children));
+      for (uint32_t i = 0; i < node->n_children; ++i) {
+        stream.write(reinterpret_cast<const char *>(&node->children[i].key),
+                     sizeof(typename N::Key));
+        stack.push_back(node->children[i].node);
+      }
+    }
+  }
+
+  // replaces the tree with one from write(). false if the stream is short or
+  // was written for another bandit, leaving an empty tree
+  bool read(std::istream &stream) {
+    using N = Node<JointBandit>;
+    *this = {};
+    uint64_t header[3];
+    if (!stream.read(reinterpret_cast<char *>(header), sizeof(header)) ||
+        header[1] != sizeof(N) || header[2] != sizeof(typename N::Key)) {
+      return false;
+    }
+    size = header[0];
+    std::vector<N *> stack{this};
+    while (!stack.empty()) {
+      auto *node = stack.back();
+      stack.pop_back();
+      stream.read(reinterpret_cast<char *>(&node->stats), sizeof(node->stats));
+      stream.read(reinterpret_cast<char *>(&node->visits),
+                  sizeof(node->visits));
+      stream.read(reinterpret_cast<char *>(&node->n_children),
+                  sizeof(node->n_children));
+      if (!stream) {
+        *this = {};
+        return false;
+      }
+      const auto k = node->n_children;
+      node->capacity = k;
+      node->children = k ? arena.allocate<Child>(k) : nullptr;
+      for (uint32_t i = 0; i < k; ++i) {
+        auto &child = node->children[i];
+        stream.read(reinterpret_cast<char *>(&child.key), sizeof(child.key));
+        child.node = arena.allocate<N>(1);
+        *child.node = {};
+        stack.push_back(child.node);
+      }
+    }
+    return true;
+  }
 };
 
 template <typename JointBandit> struct Table {
+  using Bandit = JointBandit;
+  using Stats = Entry<JointBandit>;
   using Key = uint64_t;
+  static constexpr size_t bucket_size = 8;
+  static constexpr uint8_t max_hits = 0xFF;
+
+  // stats with the count of the descents that hold them, which probe never
+  // evicts. every probe pins the entry it returns until unpin
+#pragma pack(push, 1)
+  struct Slot : Stats {
+    uint32_t pins;
+  };
+#pragma pack(pop)
+
+  // slot metadata for one bucket in a single cache line, so a hit touches
+  // this line and then only the matching slot. tags are the upper key bits
+  // (never 0, which marks an empty slot) since the lower bits pick the bucket
+  struct alignas(64) Bucket {
+    std::array<uint32_t, bucket_size> tags;
+    std::array<uint8_t, bucket_size> hits;
+    std::array<uint8_t, bucket_size> depths;
+    std::array<uint8_t, bucket_size> generations;
+    uint8_t lock;
+  };
+  static_assert(sizeof(Bucket) == 64);
+
   Hash::Battle hasher;
-  std::unordered_map<Key, JointBandit> entries;
+  std::vector<Bucket> buckets;
+  // left uninitialized, slots are reset when claimed
+  std::unique_ptr<Slot[]> slots;
+  size_t mask;
+  // bumped for each new root. entries are moved to the current generation
+  // when they are probed, the rest are evicted first
+  uint8_t generation = 0;
+
+  // handle for one of several threads searching the same table. the hasher
+  // tracks the current path so every thread needs its own copy
+  struct Shared {
+    using Bandit = JointBandit;
+    using Stats = Entry<JointBandit>;
+    Hash::Battle hasher;
+    Table *table;
+  };
+
+  // largest power of two number of buckets that fits in mb megabytes
+  static constexpr size_t bucket_count(const size_t mb) noexcept {
+    constexpr size_t bucket_bytes = sizeof(Bucket) + bucket_size * sizeof(Slot);
+    size_t n = 1;
+    while (2 * n * bucket_bytes <= (mb << 20)) {
+      n *= 2;
+    }
+    return n;
+  }
+
+  Table() = default;
+  Table(auto &device, const size_t mb)
+    requires requires { device.uniform_64(); }
+      : hasher{device} {
+    const size_t n = bucket_count(mb);
+    buckets.resize(n);
+    slots.reset(new Slot[n * bucket_size]);
+    mask = n - 1;
+  }
+
+  size_t capacity() const noexcept { return buckets.size() * bucket_size; }
+
+  // slots and bucket metadata, reported as Output::bytes
+  size_t bytes() const noexcept {
+    return capacity() * sizeof(Slot) + buckets.size() * sizeof(Bucket);
+  }
+
+  uint8_t &lock(const Key key) noexcept { return buckets[key & mask].lock; }
+
+  // called when the table is kept for the next root. on wrap every slot is
+  // swept into generation 0 and the count restarts at 1, so an entry never
+  // looks current again without being probed
+  void age() noexcept {
+    if (++generation == 0) {
+      for (auto &bucket : buckets) {
+        bucket.generations.fill(0);
+      }
+      generation = 1;
+    }
+  }
+
+  // the hasher seeds, so that the keys stay valid, then the buckets, each
+  // followed by its claimed slots
+  void write(std::ostream &stream) const {
+    const uint64_t header[5]{buckets.size(), bucket_size, sizeof(Bucket),
+                             sizeof(Slot), generation};
+    stream.write(reinterpret_cast<const char *>(header), sizeof(header));
+    stream.write(reinterpret_cast<const char *>(&hasher), sizeof(hasher));
+    for (size_t b = 0; b < buckets.size(); ++b) {
+      const auto &bucket = buckets[b];
+      stream.write(reinterpret_cast<const char *>(&bucket), sizeof(Bucket));
+      const auto claimed =
+          std::find(bucket.tags.begin(), bucket.tags.end(), 0) -
+          bucket.tags.begin();
+      const auto *data = slots.get() + b * bucket_size;
+      stream.write(reinterpret_cast<const char *>(data),
+                   claimed * sizeof(Slot));
+    }
+  }
+
+  // replaces the table with one from write(). false if the stream is short or
+  // was written for another bandit, leaving an empty table
+  bool read(std::istream &stream) {
+    *this = {};
+    uint64_t header[5];
+    if (!stream.read(reinterpret_cast<char *>(header), sizeof(header)) ||
+        header[1] != bucket_size || header[2] != sizeof(Bucket) ||
+        header[3] != sizeof(Slot) || !header[0] ||
+        (header[0] & (header[0] - 1)) ||
+        !stream.read(reinterpret_cast<char *>(&hasher), sizeof(hasher))) {
+      *this = {};
+      return false;
+    }
+    const size_t n = header[0];
+    generation = header[4];
+    buckets.resize(n);
+    slots.reset(new Slot[n * bucket_size]);
+    mask = n - 1;
+    for (size_t b = 0; b < n; ++b) {
+      auto &bucket = buckets[b];
+      stream.read(reinterpret_cast<char *>(&bucket), sizeof(Bucket));
+      bucket.lock = 0;
+      const auto claimed =
+          std::find(bucket.tags.begin(), bucket.tags.end(), 0) -
+          bucket.tags.begin();
+      auto *data = slots.get() + b * bucket_size;
+      stream.read(reinterpret_cast<char *>(data), claimed * sizeof(Slot));
+      if (!stream) {
+        *this = {};
+        return false;
+      }
+      for (auto i = 0; i < claimed; ++i) {
+        data[i].pins = 0;
+      }
+    }
+    return true;
+  }
+
+  // returns the entry for key, claiming a slot if it is not present. a full
+  // bucket replaces an old generation slot if it has one, and otherwise its
+  // least probed slot, preferring deeper ones on ties. pinned slots are never
+  // replaced, if the whole bucket is pinned the caller's scratch is reset and
+  // returned instead, so the state is evaluated as a leaf but not stored.
+  // reused is set when the entry is from an earlier generation
+  Stats &probe(const Key key, const size_t depth, bool &reused,
+               Stats &scratch) noexcept {
+    auto &bucket = buckets[key & mask];
+    auto *data = slots.get() + (key & mask) * bucket_size;
+    const uint32_t tag = std::max(uint32_t(key >> 32), uint32_t{1});
+    reused = false;
+    size_t victim = bucket_size;
+    for (size_t i = 0; i < bucket_size; ++i) {
+      // slots are never emptied so the rest of the bucket is free too
+      if (!bucket.tags[i]) {
+        victim = i;
+        break;
+      }
+      if (bucket.tags[i] == tag) {
+        if (bucket.generations[i] != generation) {
+          reused = true;
+          bucket.generations[i] = generation;
+          bucket.hits[i] = 0;
+        }
+        bucket.hits[i] += (bucket.hits[i] != max_hits);
+        ++data[i].pins;
+        return data[i];
+      }
+    }
+    // a full bucket reads the pins in order of priority, so usually only the
+    // slot that is replaced
+    if (victim == bucket_size) {
+      uint32_t checked = 0;
+      while (checked != (1 << bucket_size) - 1) {
+        size_t i = bucket_size;
+        for (size_t j = 0; j < bucket_size; ++j) {
+          if (!(checked & (1 << j)) &&
+              (i == bucket_size || priority(bucket, j) < priority(bucket, i))) {
+            i = j;
+          }
+        }
+        if (!data[i].pins) {
+          victim = i;
+          break;
+        }
+        checked |= 1 << i;
+      }
+    }
+    if (victim == bucket_size) {
+      scratch = {};
+      return scratch;
+    }
+    bucket.tags[victim] = tag;
+    bucket.hits[victim] = 1;
+    bucket.depths[victim] = std::min(depth, size_t{255});
+    bucket.generations[victim] = generation;
+    data[victim] = {};
+    data[victim].pins = 1;
+    return data[victim];
+  }
+
+  // releases an entry returned by probe
+  void unpin(const Stats &stats) noexcept {
+    const auto *begin = reinterpret_cast<const char *>(slots.get());
+    const auto *p = reinterpret_cast<const char *>(&stats);
+    if (std::less_equal{}(begin, p) &&
+        std::less{}(p, begin + capacity() * sizeof(Slot))) {
+      --slots[(p - begin) / sizeof(Slot)].pins;
+    }
+  }
+
+private:
+  uint32_t priority(const Bucket &bucket, const size_t i) const noexcept {
+    return (uint32_t{bucket.generations[i] == generation} << 16) |
+           (uint32_t{bucket.hits[i]} << 8) | (255 - bucket.depths[i]);
+  }
 };
 
 // wrapper to use for enabling matrix ucb at root heap
@@ -111,24 +612,40 @@ template <typename BanditParams> struct MatrixUCBParams {
   uint32_t interval;
   uint32_t minimum;
   float c;
+  // solve the root matrices on a helper thread instead of the search thread
+  bool async;
+};
+
+// optional rule for ending timed and iteration budgets early. the root is
+// checked `checks` times over the budget, and the search stops once neither
+// player's most visited action can be overtaken with the iterations left, or
+// once the root nash strategies moved less than `tol` for `stable`
+// consecutive checks. checks = 0 disables it, stable = 0 only uses the lead
+struct EarlyStop {
+  size_t checks;
+  size_t stable;
+  float tol;
 };
 
 struct SearchOptions {
+  // initial Search::root_rolls and Search::other_rolls
   size_t root_rolls;
   size_t other_rolls;
   bool debug_print;
-  // dependent
-  bool rolls_same;
-  bool clamping;
+  // descend in a loop with an explicit path instead of recursing
+  bool iterative;
 
   constexpr SearchOptions(size_t root_rolls = 39, size_t other_rolls = 39,
-                          bool debug_print = false)
+                          bool debug_print = false, bool iterative = false)
       : root_rolls{root_rolls}, other_rolls{other_rolls},
-        debug_print{debug_print}, rolls_same{root_rolls == other_rolls},
-        clamping{(root_rolls != 39) || (other_rolls != 39)} {}
+        debug_print{debug_print}, iterative{iterative} {}
 };
 
+#ifdef ITERATIVE_SEARCH
+constexpr SearchOptions default_search{3, 1, false, true};
+#else
 constexpr SearchOptions default_search{3, 1};
+#endif
 
 template <SearchOptions Options = default_search> struct Search {
 
@@ -145,17 +662,329 @@ template <SearchOptions Options = default_search> struct Search {
   std::array<float, 9 + 2> p1_nash;
   std::array<float, 9 + 2> p2_nash;
 
-  // beta
-  size_t beta_n = 10;
+  static constexpr float beta_tol = 1e-3;
 
   size_t total_depth;
   size_t errors;
+  size_t probes;
+  size_t reused;
+
+  // configuration, not reset by init_root
+  size_t batch_size = 1;
+  EarlyStop early_stop{};
+  // memory cap of a tree heap, 0 for none. once it is reached the tree is
+  // pruned to half of it before the next iterations, and the iterations that
+  // are already running stop adding nodes
+  size_t max_bytes = 0;
+  // exploitability target for the float solver used on the root matrices,
+  // warm started from the last solution. 0 solves them exactly with LRSNash,
+  // which is also the fallback when the target is not met
+  float nash_tol = 0;
+  // beta resamples, see process_output. 0 skips the resampling
+  size_t beta_n = 0;
+  // damage rolls kept at the root and below it, one of 1, 2, 3, 20 or 39.
+  // 39 keeps every roll, see battle_options_set
+  size_t root_rolls = Options.root_rolls;
+  size_t other_rolls = Options.other_rolls;
+
+  // the members above, kept by init_root and copied to parallel workers
+  auto config() noexcept {
+    return std::tie(batch_size, early_stop, max_bytes, nash_tol, beta_n,
+                    root_rolls, other_rolls);
+  }
+
+  // early stop
+  size_t stable_checks;
+  std::array<float, 9 + 2> last_p1_nash;
+  std::array<float, 9 + 2> last_p2_nash;
+
+  static constexpr size_t max_depth = 100;
+
+  // where the nodes of a tree heap are allocated, and their count
+  Arena *arena;
+  size_t *tree_size;
+
+  // matrix ucb root solves on a helper thread. the search thread publishes
+  // the ucb matrices and samples from the newest strategies the helper has
+  // published, so neither waits for the other
+  struct RootStrategies {
+    std::array<float, 9 + 2> p1;
+    std::array<float, 9 + 2> p2;
+  };
+  struct RootMatrices {
+    std::array<float, 9 * 9> p1;
+    std::array<float, 9 * 9> p2;
+    int m;
+    int n;
+    // warm start
+    RootStrategies strategies;
+  };
+  struct AsyncSolve {
+    TripleBuffer<RootMatrices> matrices;
+    TripleBuffer<RootStrategies> strategies;
+    // bumped to wake the helper for new matrices or to stop it
+    std::atomic<uint32_t> version{};
+    std::atomic<bool> done{};
+  };
+  AsyncSolve *async_solve;
 
   Output run(auto &device, const auto budget, const auto &params, auto &heap,
              auto &eval, const Input &input, Output output = {}) noexcept {
+    search(device, budget, params, heap, eval, input, output);
+    process_output(output, device, beta_n);
+    return output;
+  }
+
+  // parallel search. each worker has its own device and eval copy (network
+  // scratch is not shareable) and the root matrices are summed before the
+  // final solve. trees are searched root parallel with private heaps, the
+  // first worker running on the calling thread with the caller's heap so that
+  // it can still be reused by Heap::update. tables are shared by all workers,
+  // using virtual loss to spread them over different paths. clones holds the
+  // eval copies of the other workers and should be kept between searches
+  Output run_parallel(const size_t threads, auto &device, const auto budget,
+                      const auto &params, auto &heap, auto &eval,
+                      auto &clones, const Input &input, Output output = {}) {
+    using Heap = std::remove_cvref_t<decltype(heap)>;
+    if constexpr (is_table<Heap>) {
+      // set up the root once so that the workers don't race on the priors
+      init_root(device, params, heap, eval, input, output);
+      // as_const so the hasher is copied, not seeded with itself
+      std::vector<typename Heap::Shared> shared(
+          threads, typename Heap::Shared{std::as_const(heap.hasher), &heap});
+      run_workers(
+          threads, device, budget, params,
+          [&shared](const size_t t) -> auto & { return shared[t]; }, eval,
+          clones, input, output);
+      // the workers only see their handles, so the table is measured once
+      output.nodes = 0;
+      output.bytes = heap.bytes();
+    } else {
+      std::vector<Heap> heaps(threads - 1);
+      run_workers(
+          threads, device, budget, params,
+          [&heap, &heaps](const size_t t) -> auto & {
+            return t ? heaps[t - 1] : heap;
+          },
+          eval, clones, input, output);
+    }
+    process_output(output, device, beta_n);
+    return output;
+  }
+
+  // run search on the calling thread and threads - 1 others, then merge
+  void run_workers(const size_t threads, auto &device, const auto budget,
+                   const auto &params, const auto &worker_heap, auto &eval,
+                   auto &clones, const Input &input, Output &output) {
+    using Device = std::remove_cvref_t<decltype(device)>;
+    using Eval = std::remove_cvref_t<decltype(eval)>;
+
+    // iteration budgets are split, the others are shared
+    const auto worker_budget = [threads, budget](const size_t t) {
+      if constexpr (std::is_integral_v<decltype(budget)>) {
+        return static_cast<decltype(budget)>(budget / threads +
+                                             (t < (budget % threads)));
+      } else {
+        return budget;
+      }
+    };
+
+    const size_t n = threads - 1;
+    std::vector<Search> searches(n);
+    for (auto &s : searches) {
+      s.config() = config();
+    }
+    std::vector<Device> devices;
+    std::vector<Output> outputs(n);
+    devices.reserve(n);
+    for (size_t t = 0; t < n; ++t) {
+      devices.emplace_back(device.random_seed());
+    }
+    // networks are only copied by the first search, after that just their
+    // battle cache when fill_cache changed it
+    if (clones.size() < n) {
+      clones.resize(n, eval);
+    }
+    if constexpr (is_network<Eval>) {
+      for (auto &clone : clones) {
+        if (clone.cache_version != eval.cache_version) {
+          clone.battle_cache = eval.battle_cache;
+          clone.cache_version = eval.cache_version;
+        }
+      }
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(n);
+    for (size_t t = 0; t < n; ++t) {
+      workers.emplace_back([&, t]() {
+        searches[t].search(devices[t], worker_budget(t + 1), params,
+                           worker_heap(t + 1), clones[t], input, outputs[t]);
+      });
+    }
+    search(device, worker_budget(0), params, worker_heap(0), eval, input,
+           output);
+    for (auto &worker : workers) {
+      worker.join();
+    }
+
+    for (const auto &other : outputs) {
+      merge(output, other);
+    }
+  }
+
+  // sum the root statistics of another search of the same position
+  static void merge(Output &output, const Output &other) noexcept {
+    for (auto i = 0; i < 9; ++i) {
+      for (auto j = 0; j < 9; ++j) {
+        output.visit_matrix[i][j] += other.visit_matrix[i][j];
+        output.value_matrix[i][j] += other.value_matrix[i][j];
+      }
+    }
+    output.iterations += other.iterations;
+    output.nodes += other.nodes;
+    output.bytes += other.bytes;
+    output.probes += other.probes;
+    output.reused += other.reused;
+  }
+
+  // all of run except for the final solve
+  void search(auto &device, const auto budget, const auto &params, auto &heap,
+              auto &eval, const Input &input, Output &output) noexcept {
+    init_root(device, params, heap, eval, input, output);
+
+    // the helper only lives for this search
+    std::optional<AsyncSolve> async;
+    std::thread helper;
+    if constexpr (is_matrix_ucb<decltype(params)>) {
+      if (params.async) {
+        async_solve = &async.emplace();
+        helper = std::thread{[this] { solve_root_matrices(*async_solve); }};
+      }
+    }
+
+    const auto start = Clock::now();
+    // absolute deadline
+    if constexpr (std::is_same_v<decltype(budget), const Clock::time_point>) {
+      run_until(device, budget, start, params, heap, eval, input, output);
+      // time duration
+    } else if constexpr (requires {
+                           std::chrono::duration_cast<Clock::duration>(budget);
+                         }) {
+      run_until(device,
+                start + std::chrono::duration_cast<Clock::duration>(budget),
+                start, params, heap, eval, input, output);
+      // run while the atomic flag is set. it is only a stop signal, so the
+      // load can be relaxed
+    } else if constexpr (requires { budget->load(); }) {
+      while (budget->load(std::memory_order_relaxed)) {
+        output.iterations += run_root_iterations(device, params, heap, input,
+                                                 eval, output, batch_size);
+      }
+      // number of iterations
+    } else {
+      const size_t total = budget;
+      const size_t check_interval =
+          std::max(total / std::max(early_stop.checks, size_t{1}), size_t{1});
+      size_t next_check = check_interval;
+      for (size_t i = 0; i < total;) {
+        const auto n = run_root_iterations(device, params, heap, input, eval,
+                                           output,
+                                           std::min(batch_size, total - i));
+        i += n;
+        output.iterations += n;
+        if (early_stop.checks && i >= next_check && i < total) {
+          next_check += check_interval;
+          if (stop_early(output, total - i)) {
+            break;
+          }
+        }
+      }
+    }
+    const auto end = Clock::now();
+    output.duration +=
+        std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+    if (async) {
+      async->done.store(true, std::memory_order_release);
+      async->version.fetch_add(1, std::memory_order_release);
+      async->version.notify_one();
+      helper.join();
+      async_solve = nullptr;
+    }
+    using Heap = std::remove_cvref_t<decltype(heap)>;
+    output.probes = probes;
+    output.reused = reused;
+    if constexpr (is_node<Heap>) {
+      output.nodes = heap.size;
+      output.bytes = heap.arena.allocated;
+    } else if constexpr (!is_shared_table<Heap>) {
+      output.nodes = 0;
+      output.bytes = heap.bytes();
+    }
+  }
+
+  // the clock is only read every `stride` iterations. the stride is set from
+  // the iteration rate since the last read so that reads are about
+  // clock_interval apart, which is also roughly the most a search overshoots
+  void run_until(auto &device, const Clock::time_point deadline,
+                 const Clock::time_point start, const auto &params, auto &heap,
+                 auto &eval, const Input &input, Output &output) noexcept {
+    static constexpr std::chrono::nanoseconds clock_interval{100'000};
+    static constexpr size_t max_stride = 1 << 12;
+
+    const auto check_interval =
+        (deadline - start) / std::max(early_stop.checks, size_t{1});
+    auto next_check = start + check_interval;
+    const auto start_iterations = output.iterations;
+    size_t stride = 1;
+    size_t since_read = 0;
+    auto now = start;
+    while (now < deadline) {
+      const auto n = run_root_iterations(device, params, heap, input, eval,
+                                         output, batch_size);
+      output.iterations += n;
+      since_read += n;
+      if (since_read < stride) {
+        continue;
+      }
+      const auto last = now;
+      now = Clock::now();
+      const auto ns = std::max<int64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(now - last)
+              .count(),
+          1);
+      stride = std::clamp<size_t>(since_read * clock_interval.count() / ns, 1,
+                                  max_stride);
+      since_read = 0;
+
+      if (early_stop.checks && now >= next_check && now < deadline) {
+        next_check += check_interval;
+        // remaining iterations at the rate of this search so far
+        const size_t remaining = (output.iterations - start_iterations) *
+                                 (deadline - now).count() /
+                                 std::max((now - start).count(), Clock::rep{1});
+        if (stop_early(output, remaining)) {
+          break;
+        }
+      }
+    }
+  }
+
+  // reset, get the root choices and initialize the root stats if needed
+  void init_root(auto &device, const auto &params, auto &heap, auto &eval,
+                 const Input &input, Output &output) noexcept {
 
-    // reset data members
+    // reset data members except for the configuration
+    const auto saved = std::apply(
+        [](const auto &...value) { return std::tuple{value...}; }, config());
     *this = {};
+    config() = saved;
+    // a reused output keeps the reason its last search stopped early
+    output.stop = Stop::budget;
+    if constexpr (is_node<decltype(heap)>) {
+      arena = &heap.arena;
+      tree_size = &heap.size;
+    }
 
     // get choices data here for matrix ucb
     output.p1.k = pkmn_gen1_battle_choices(
@@ -170,21 +999,31 @@ template <SearchOptions Options = default_search> struct Search {
 
     if constexpr (is_poke_engine<decltype(eval)>) {
       eval.get_root_score(input.battle);
+    } else if constexpr (is_monte_carlo<decltype(eval)>) {
+      eval.engine.get_root_score(input.battle);
     }
 
+    uint64_t key = 0;
+    [[maybe_unused]] Scratch<decltype(heap)> scratch;
     auto &stats = [&]() -> auto & {
       if constexpr (is_node<decltype(heap)>) {
         return heap.stats;
       } else {
         heap.hasher.init(input.battle, input.durations);
         root_hash_state = heap.hasher.state();
-        return heap.entries[heap.hasher.last()];
+        key = heap.hasher.last();
+        return entry(heap, 0, scratch);
       }
     }();
 
+    // workers of a shared table check the root under its lock. run_parallel
+    // has already initialized it, so the lock is not held for an inference
+    const auto lock = guard(heap, key);
     if (!stats.is_init()) {
 
       stats.init(output.p1.k, output.p2.k);
+      stats.init_choices(output.p1.choices.data(), output.p1.k,
+                         output.p2.choices.data(), output.p2.k);
 
       const auto bandit_params = [](const auto &params) -> const auto & {
         if constexpr (requires { params.bandit_params; }) {
@@ -210,47 +1049,12 @@ template <SearchOptions Options = default_search> struct Search {
         softmax(output.p2.prior.data(), p2_logits.data(), output.p2.k);
       }
     }
-
-    const auto start = std::chrono::high_resolution_clock::now();
-    // time duration
-    if constexpr (requires {
-                    std::chrono::duration_cast<std::chrono::microseconds>(
-                        budget);
-                  }) {
-      const auto duration =
-          std::chrono::duration_cast<std::chrono::microseconds>(budget);
-      std::chrono::microseconds elapsed{};
-      while (elapsed < duration) {
-        run_root_iteration(device, params, heap, input, eval, output);
-        ++output.iterations;
-        elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
-            std::chrono::high_resolution_clock::now() - start);
-      }
-      // run while boolean flag is set
-    } else if constexpr (requires { *budget; }) {
-      while (*budget) {
-        run_root_iteration(device, params, heap, input, eval, output);
-        ++output.iterations;
-      }
-      // number of iterations
-    } else {
-      for (auto i = 0; i < budget; ++i) {
-        run_root_iteration(device, params, heap, input, eval, output);
-        ++output.iterations;
-      }
-    }
-    const auto end = std::chrono::high_resolution_clock::now();
-    output.duration +=
-        std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-
-    process_output(output, beta_n);
-    return output;
+    unpin(heap, stats);
   }
 
-  float run_root_iteration(auto &device, const auto &params, auto &heap,
-                           const auto &input, auto &eval,
-                           Output &output) noexcept {
-
+  // copy of the root with new rng and hidden information, and the options
+  // and hasher reset for a descent from it
+  Input root_copy(auto &device, auto &heap, const Input &input) noexcept {
     auto copy = input;
     auto *rng = reinterpret_cast<uint64_t *>(
         copy.battle.bytes + PKMN::Layout::Offsets::Battle::rng);
@@ -261,6 +1065,14 @@ template <SearchOptions Options = default_search> struct Search {
     if constexpr (is_table<decltype(heap)>) {
       heap.hasher.set(root_hash_state);
     }
+    return copy;
+  }
+
+  float run_root_iteration(auto &device, const auto &params, auto &heap,
+                           const auto &input, auto &eval,
+                           Output &output) noexcept {
+
+    auto copy = root_copy(device, heap, input);
 
     if constexpr (!is_matrix_ucb<decltype(params)>) {
       return run_iteration(device, params, heap, copy, eval, output).first;
@@ -281,7 +1093,7 @@ template <SearchOptions Options = default_search> struct Search {
           if constexpr (is_node<decltype(heap)>) {
             const auto &obs = *reinterpret_cast<const Obs *>(
                 pkmn_gen1_battle_options_chance_actions(&options));
-            auto &child = heap.children[{p1_index, p2_index, obs}];
+            auto &child = expand(heap, {p1_index, p2_index, obs});
             return run_iteration(device, params.bandit_params, child, copy,
                                  eval, output, 1);
           } else {
@@ -298,15 +1110,26 @@ template <SearchOptions Options = default_search> struct Search {
     }
   }
 
-  // typical recursive mcts function
-  // we return value for each player because it's slightly faster than calcing 1
-  // - value at each heap
   std::pair<float, float> run_iteration(auto &device, const auto &bandit_params,
                                         auto &heap, auto &input, auto &eval,
                                         Output &output,
                                         size_t depth = 0) noexcept {
-    static constexpr size_t max_depth = 100;
+    if constexpr (Options.iterative) {
+      return run_iteration_iterative(device, bandit_params, heap, input, eval,
+                                     output, depth);
+    } else {
+      return run_iteration_recursive(device, bandit_params, heap, input, eval,
+                                     output, depth);
+    }
+  }
 
+  // typical recursive mcts function
+  // we return value for each player because it's slightly faster than calcing 1
+  // - value at each heap
+  std::pair<float, float>
+  run_iteration_recursive(auto &device, const auto &bandit_params, auto &heap,
+                          auto &input, auto &eval, Output &output,
+                          size_t depth = 0) noexcept {
     bool error = false;
     if constexpr (is_table<decltype(heap)>) {
       if (depth >= max_depth) {
@@ -318,28 +1141,43 @@ template <SearchOptions Options = default_search> struct Search {
 
     auto &battle = input.battle;
     auto &result = input.result;
+    const uint64_t key = [&]() -> uint64_t {
+      if constexpr (is_table<decltype(heap)>) {
+        return heap.hasher.last();
+      } else {
+        return 0;
+      }
+    }();
+    [[maybe_unused]] Scratch<decltype(heap)> scratch;
     auto &stats = [&]() -> auto & {
       if constexpr (is_node<decltype(heap)>) {
+        ++heap.visits;
         return heap.stats;
       } else {
-        return heap.entries[heap.hasher.last()];
+        return entry(heap, depth, scratch);
       }
     }();
 
-    if (stats.is_init() && !error) {
-      using Bandit = std::remove_reference_t<decltype(stats)>;
-      using JointOutcome = typename Bandit::JointOutcome;
-
-      // do bandit
-      JointOutcome outcome;
+    using Bandit = std::remove_reference_t<decltype(stats)>;
+    using JointOutcome = typename Bandit::JointOutcome;
+    JointOutcome outcome;
 
+    // select under the lock, the rest of the iteration does not hold it
+    const bool selected = [&]() {
+      const auto lock = guard(heap, key);
+      if (!stats.is_init() || error) {
+        return false;
+      }
       stats.select(device, bandit_params, outcome);
-      pkmn_gen1_battle_choices(&battle, PKMN_PLAYER_P1, pkmn_result_p1(result),
-                               p1_choices.data(), PKMN_GEN1_MAX_CHOICES);
-      const auto c1 = p1_choices[outcome.p1.index];
-      pkmn_gen1_battle_choices(&battle, PKMN_PLAYER_P2, pkmn_result_p2(result),
-                               p2_choices.data(), PKMN_GEN1_MAX_CHOICES);
-      const auto c2 = p2_choices[outcome.p2.index];
+      if constexpr (is_shared_table<decltype(heap)>) {
+        stats.virtual_loss(outcome);
+      }
+      return true;
+    }();
+
+    if (selected) {
+      const auto c1 = stats.p1_choices[outcome.p1.index];
+      const auto c2 = stats.p2_choices[outcome.p2.index];
 
       if constexpr (is_node<decltype(heap)>) {
         battle_options_set(battle, depth);
@@ -357,13 +1195,12 @@ template <SearchOptions Options = default_search> struct Search {
         if constexpr (is_node<decltype(heap)>) {
           const auto &obs = *reinterpret_cast<const Obs *>(
               pkmn_gen1_battle_options_chance_actions(&options));
-          auto &child =
-              heap.children[{outcome.p1.index, outcome.p2.index, obs}];
-          return run_iteration(device, bandit_params, child, input, eval,
-                               output, depth + 1);
+          auto &child = expand(heap, {outcome.p1.index, outcome.p2.index, obs});
+          return run_iteration_recursive(device, bandit_params, child, input,
+                                         eval, output, depth + 1);
         } else {
-          return run_iteration(device, bandit_params, heap, input, eval, output,
-                               depth + 1);
+          return run_iteration_recursive(device, bandit_params, heap, input,
+                                         eval, output, depth + 1);
         }
       }();
       outcome.p1.value = value.first;
@@ -371,6 +1208,10 @@ template <SearchOptions Options = default_search> struct Search {
 
       if constexpr (is_node<decltype(heap)>) {
         stats.update(outcome);
+      } else if constexpr (is_shared_table<decltype(heap)>) {
+        const auto lock = guard(heap, key);
+        stats.virtual_update(outcome);
+        unpin(heap, stats);
       } else {
         if (!turn_limit(battle)) {
           stats.update(outcome);
@@ -378,6 +1219,7 @@ template <SearchOptions Options = default_search> struct Search {
           stats.update(outcome);
           // return {0.5, 0.5};
         }
+        unpin(heap, stats);
       }
 
       if (depth == 0) {
@@ -389,14 +1231,324 @@ template <SearchOptions Options = default_search> struct Search {
     }
 
     total_depth += depth;
+    const auto value =
+        leaf_value(device, bandit_params, heap, key, stats, input, eval);
+    release(heap, key, stats);
+    return value;
+  }
+
+  // storage for a table entry that is not stored, one per descent since the
+  // descent stops there. nothing for trees
+  struct NoScratch {};
+  template <typename Heap>
+  using Scratch =
+      std::conditional_t<is_table<Heap>,
+                         typename std::remove_cvref_t<Heap>::Stats, NoScratch>;
+
+  // stats selected by one descent, root first, and the stats it stopped at
+  template <typename Bandit> struct Path {
+    struct Frame {
+      Bandit *stats;
+      uint64_t key;
+      typename Bandit::JointOutcome outcome;
+    };
+    std::array<Frame, max_depth> frames;
+    size_t size;
+    Bandit *leaf;
+    uint64_t key;
+    // the leaf when its table bucket is fully pinned
+    Bandit scratch;
+  };
+
+  // same as run_iteration_recursive but the descent is a loop that records
+  // the path, which is then updated leaf to root. the path has a fixed size
+  // so trees get the same depth limit as tables
+  std::pair<float, float>
+  run_iteration_iterative(auto &device, const auto &bandit_params, auto &heap,
+                          auto &input, auto &eval, Output &output,
+                          const size_t root_depth = 0) noexcept {
+    using Heap = std::remove_cvref_t<decltype(heap)>;
+    Path<typename Heap::Stats> path;
+    descend(device, bandit_params, heap, input, path, false, root_depth);
+    const auto value = leaf_value(device, bandit_params, heap, path.key,
+                                  *path.leaf, input, eval);
+    release(heap, path.key, *path.leaf);
+    backup(heap, path, value, false);
+    if (root_depth == 0) {
+      update_root_matrix(output, path, value);
+    }
+    return value;
+  }
+
+  // selects and applies actions from the root until stats that are not
+  // initialized or the depth limit. batched descents add virtual loss along
+  // the way so that the ones after them take other paths
+  void descend(auto &device, const auto &bandit_params, auto &heap,
+               auto &input, auto &path, const bool batched,
+               size_t depth) noexcept {
+    using Heap = std::remove_cvref_t<decltype(heap)>;
+    // trees descend through their nodes, tables stay on the same heap
+    using Cursor =
+        std::conditional_t<is_node<Heap>, Node<typename Heap::Bandit>, Heap>;
+
+    auto &battle = input.battle;
+    auto &result = input.result;
+    Cursor *cursor = &heap;
+    path.size = 0;
+
+    while (true) {
+      bool error = false;
+      if (depth >= max_depth) {
+        set_turn_limit(battle);
+        ++errors;
+        error = true;
+      }
+
+      const uint64_t key = [&]() -> uint64_t {
+        if constexpr (is_table<Heap>) {
+          return heap.hasher.last();
+        } else {
+          return 0;
+        }
+      }();
+      auto &stats = [&]() -> auto & {
+        if constexpr (is_node<Heap>) {
+          ++cursor->visits;
+          return cursor->stats;
+        } else {
+          return entry(heap, depth, path.scratch);
+        }
+      }();
+
+      const auto stop = [&]() {
+        total_depth += depth;
+        path.leaf = &stats;
+        path.key = key;
+      };
+      // the path is full at the depth limit, so there is no frame to select
+      // into
+      if (error) {
+        stop();
+        return;
+      }
+
+      auto &frame = path.frames[path.size];
+      const bool selected = [&]() {
+        const auto lock = guard(heap, key);
+        if (!stats.is_init()) {
+          return false;
+        }
+        stats.select(device, bandit_params, frame.outcome);
+        if (batched || is_shared_table<Heap>) {
+          stats.virtual_loss(frame.outcome);
+        }
+        return true;
+      }();
+
+      if (!selected) {
+        stop();
+        return;
+      }
+
+      frame.stats = &stats;
+      frame.key = key;
+      ++path.size;
+
+      const auto &outcome = frame.outcome;
+      const auto c1 = stats.p1_choices[outcome.p1.index];
+      const auto c2 = stats.p2_choices[outcome.p2.index];
+
+      if constexpr (is_node<Heap>) {
+        battle_options_set(battle, depth);
+      } else {
+        pkmn_gen1_battle_options_set(&options, nullptr, nullptr, nullptr);
+      }
+      result = pkmn_gen1_battle_update(&battle, c1, c2, &options);
+
+      if constexpr (is_node<Heap>) {
+        const auto &obs = *reinterpret_cast<const Obs *>(
+            pkmn_gen1_battle_options_chance_actions(&options));
+        cursor = &expand(*cursor, {outcome.p1.index, outcome.p2.index, obs});
+      } else {
+        heap.hasher.update(battle, durations(), c1, c2);
+      }
+      ++depth;
+    }
+  }
+
+  // child of node for key. at the memory cap no children are added, and the
+  // descent continues into a scratch node so the state is evaluated but not
+  // stored
+  template <typename N>
+  Node<typename N::Bandit> &
+  expand(N &node, const typename Node<typename N::Bandit>::Key &key) noexcept {
+    if (max_bytes && arena->allocated >= max_bytes) {
+      if (auto *child = node.find(key)) {
+        return *child;
+      }
+      static thread_local Node<typename N::Bandit> scratch;
+      scratch = {};
+      return scratch;
+    }
+    const auto n = node.n_children;
+    auto &child = node.child(key, *arena);
+    *tree_size += node.n_children - n;
+    return child;
+  }
+
+  // updates the path leaf to root with the value of its leaf and unpins it.
+  // descents that added virtual loss must be finished with virtual_update
+  void backup(auto &heap, auto &path, const std::pair<float, float> value,
+              const bool batched) noexcept {
+    for (size_t i = path.size; i-- > 0;) {
+      auto &[stats, key, outcome] = path.frames[i];
+      outcome.p1.value = value.first;
+      outcome.p2.value = value.second;
+      if (batched || is_shared_table<decltype(heap)>) {
+        const auto lock = guard(heap, key);
+        stats->virtual_update(outcome);
+        unpin(heap, *stats);
+      } else {
+        stats->update(outcome);
+        unpin(heap, *stats);
+      }
+    }
+  }
+
+  static void update_root_matrix(Output &output, const auto &path,
+                                 const std::pair<float, float> value) noexcept {
+    if (path.size) {
+      const auto &outcome = path.frames[0].outcome;
+      ++output.visit_matrix[outcome.p1.index][outcome.p2.index];
+      output.value_matrix[outcome.p1.index][outcome.p2.index] += value.first;
+    }
+  }
+
+  // runs the next n iterations, batching the leaf evaluations when possible.
+  // returns the number of iterations run
+  size_t run_root_iterations(auto &device, const auto &params, auto &heap,
+                             const Input &input, auto &eval, Output &output,
+                             const size_t iterations) noexcept {
+    if constexpr (is_node<decltype(heap)>) {
+      if (max_bytes && heap.arena.allocated >= max_bytes) {
+        heap.prune(max_bytes / 2);
+      }
+    }
+    if constexpr (is_network<decltype(eval)> &&
+                  !is_matrix_ucb<decltype(params)>) {
+      if (iterations > 1) {
+        run_root_batch(device, params, heap, input, eval, output, iterations);
+        return iterations;
+      }
+    }
+    run_root_iteration(device, params, heap, input, eval, output);
+    return 1;
+  }
+
+  // n descents with virtual loss, then one batched inference for the leaves
+  // that need it, then the updates
+  void run_root_batch(auto &device, const auto &bandit_params, auto &heap,
+                      const Input &input, auto &eval, Output &output,
+                      const size_t iterations) noexcept {
+    using Heap = std::remove_cvref_t<decltype(heap)>;
+    using Bandit = typename Heap::Stats;
+    struct Pending {
+      Input input;
+      Path<Bandit> path;
+      std::array<pkmn_choice, 9> p1_choices;
+      std::array<pkmn_choice, 9> p2_choices;
+      std::array<float, 9> p1_logits;
+      std::array<float, 9> p2_logits;
+    };
+    static thread_local std::vector<Pending> pending;
+    static thread_local std::vector<NN::Battle::BatchEntry> entries;
+    if (pending.size() < iterations) {
+      pending.resize(iterations);
+    }
+    entries.clear();
+
+    for (size_t i = 0; i < iterations; ++i) {
+      auto &p = pending[entries.size()];
+      p.input = root_copy(device, heap, input);
+      descend(device, bandit_params, heap, p.input, p.path, true, 0);
+      auto &[battle, durations, result] = p.input;
+      if (pkmn_result_type(result)) {
+        const auto value = leaf_value(device, bandit_params, heap, p.path.key,
+                                      *p.path.leaf, p.input, eval);
+        release(heap, p.path.key, *p.path.leaf);
+        backup(heap, p.path, value, true);
+        update_root_matrix(output, p.path, value);
+        continue;
+      }
+      durations = this->durations();
+      const auto m = pkmn_gen1_battle_choices(
+          &battle, PKMN_PLAYER_P1, pkmn_result_p1(result), p.p1_choices.data(),
+          PKMN_GEN1_MAX_CHOICES);
+      const auto n = pkmn_gen1_battle_choices(
+          &battle, PKMN_PLAYER_P2, pkmn_result_p2(result), p.p2_choices.data(),
+          PKMN_GEN1_MAX_CHOICES);
+      entries.push_back({&battle, &durations, static_cast<int>(m),
+                         static_cast<int>(n), p.p1_choices.data(),
+                         p.p2_choices.data(), p.p1_logits.data(),
+                         p.p2_logits.data(), 0});
+    }
+
+    if (entries.empty()) {
+      return;
+    }
+    if constexpr (is_contextual_bandit<Bandit>) {
+      eval.value_policy_inference(std::span{entries});
+    } else {
+      eval.value_inference(std::span{entries});
+    }
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+      auto &p = pending[i];
+      const auto &entry = entries[i];
+      auto &stats = *p.path.leaf;
+      {
+        const auto lock = guard(heap, p.path.key);
+        // several pending leaves can share stats, only the first sets them up
+        if (!stats.is_init()) {
+          stats.init(entry.m, entry.n);
+          stats.init_choices(entry.p1_choices, entry.m, entry.p2_choices,
+                             entry.n);
+          if constexpr (is_contextual_bandit<Bandit>) {
+            stats.softmax_logits(bandit_params, entry.p1_logits,
+                                 entry.p2_logits);
+          }
+        }
+        unpin(heap, stats);
+      }
+      const std::pair<float, float> value{entry.value, 1 - entry.value};
+      backup(heap, p.path, value, true);
+      update_root_matrix(output, p.path, value);
+    }
+  }
+
+  // initializes the stats of a leaf and returns its value for each player
+  std::pair<float, float> leaf_value(auto &device, const auto &bandit_params,
+                                     auto &heap, const uint64_t key,
+                                     auto &stats, auto &input,
+                                     auto &eval) noexcept {
+    auto &battle = input.battle;
+    auto &result = input.result;
 
     switch (pkmn_result_type(result)) {
     case PKMN_RESULT_NONE:
       [[likely]] {
         using T = decltype(eval);
         float value;
+        const auto init_stats = [&](const auto m, const auto n) {
+          const auto lock = guard(heap, key);
+          if (!stats.is_init()) {
+            stats.init(m, n);
+            stats.init_choices(p1_choices.data(), m, p2_choices.data(), n);
+          }
+        };
         if constexpr (is_monte_carlo<T>) {
-          value = init_stats_and_rollout(stats, device, battle, result);
+          value = init_stats_and_rollout(init_stats, device, eval, battle,
+                                         result);
         } else {
           const auto m = pkmn_gen1_battle_choices(
               &battle, PKMN_PLAYER_P1, pkmn_result_p1(result),
@@ -404,9 +1556,6 @@ template <SearchOptions Options = default_search> struct Search {
           const auto n = pkmn_gen1_battle_choices(
               &battle, PKMN_PLAYER_P2, pkmn_result_p2(result),
               p2_choices.data(), PKMN_GEN1_MAX_CHOICES);
-          if (!stats.is_init()) {
-            stats.init(m, n);
-          }
 
           if constexpr (is_network<T>) {
             if constexpr (is_contextual_bandit<decltype(stats)>) {
@@ -415,12 +1564,22 @@ template <SearchOptions Options = default_search> struct Search {
               value = eval.value_policy_inference(
                   battle, durations(), m, n, p1_choices.data(),
                   p2_choices.data(), p1_logits.data(), p2_logits.data());
-              stats.softmax_logits(bandit_params, p1_logits.data(),
-                                   p2_logits.data());
+              // init and priors are set together so no thread selects
+              // with an initialized entry that is missing its priors
+              const auto lock = guard(heap, key);
+              // a leaf reached again keeps its priors and statistics
+              if (!stats.is_init()) {
+                stats.init(m, n);
+                stats.init_choices(p1_choices.data(), m, p2_choices.data(), n);
+                stats.softmax_logits(bandit_params, p1_logits.data(),
+                                     p2_logits.data());
+              }
             } else {
+              init_stats(m, n);
               value = eval.value_inference(battle, durations());
             }
           } else if constexpr (is_poke_engine<T>) {
+            init_stats(m, n);
             value = eval.evaluate(battle);
           } else {
             static_assert(!std::is_same_v<T, T>);
@@ -445,36 +1604,47 @@ template <SearchOptions Options = default_search> struct Search {
     };
   }
 
-  float init_stats_and_rollout(auto &stats, auto &device,
-                               pkmn_gen1_battle &battle,
-                               pkmn_result result) noexcept {
-
-    auto seed = device.uniform_64();
-    auto m = pkmn_gen1_battle_choices(&battle, PKMN_PLAYER_P1,
-                                      pkmn_result_p1(result), p1_choices.data(),
-                                      PKMN_GEN1_MAX_CHOICES);
-    auto c1 = p1_choices[seed % m];
-    auto n = pkmn_gen1_battle_choices(&battle, PKMN_PLAYER_P2,
-                                      pkmn_result_p2(result), p2_choices.data(),
-                                      PKMN_GEN1_MAX_CHOICES);
-    seed >>= 32;
-    auto c2 = p2_choices[seed % n];
-    pkmn_gen1_battle_options_set(&options, nullptr, nullptr, nullptr);
-    result = pkmn_gen1_battle_update(&battle, c1, c2, &options);
-    if (!stats.is_init()) {
-      stats.init(m, n);
-    }
-    while (!pkmn_result_type(result)) {
-      seed = device.uniform_64();
-      m = pkmn_gen1_battle_choices(&battle, PKMN_PLAYER_P1,
-                                   pkmn_result_p1(result), p1_choices.data(),
-                                   PKMN_GEN1_MAX_CHOICES);
-      c1 = p1_choices[seed % m];
-      n = pkmn_gen1_battle_choices(&battle, PKMN_PLAYER_P2,
-                                   pkmn_result_p2(result), p2_choices.data(),
-                                   PKMN_GEN1_MAX_CHOICES);
+  float init_stats_and_rollout(const auto &init_stats, auto &device,
+                               const MonteCarlo &mc, pkmn_gen1_battle &battle,
+                               const pkmn_result result) noexcept {
+    const auto m = pkmn_gen1_battle_choices(
+        &battle, PKMN_PLAYER_P1, pkmn_result_p1(result), p1_choices.data(),
+        PKMN_GEN1_MAX_CHOICES);
+    const auto n = pkmn_gen1_battle_choices(
+        &battle, PKMN_PLAYER_P2, pkmn_result_p2(result), p2_choices.data(),
+        PKMN_GEN1_MAX_CHOICES);
+    init_stats(m, n);
+    if (mc.rollouts <= 1) {
+      return rollout(device, mc, battle, result);
+    }
+    float value = 0;
+    for (size_t i = 0; i < mc.rollouts; ++i) {
+      auto copy = battle;
+      value += rollout(device, mc, copy, result);
+    }
+    return value / mc.rollouts;
+  }
+
+  float rollout(auto &device, const MonteCarlo &mc, pkmn_gen1_battle &battle,
+                pkmn_result result) noexcept {
+    for (size_t turn = 0; !pkmn_result_type(result); ++turn) {
+      if (mc.turns && turn >= mc.turns) {
+        return mc.engine.evaluate(battle);
+      }
+      auto seed = device.uniform_64();
+      const auto m = pkmn_gen1_battle_choices(
+          &battle, PKMN_PLAYER_P1, pkmn_result_p1(result), p1_choices.data(),
+          PKMN_GEN1_MAX_CHOICES);
+      const auto n = pkmn_gen1_battle_choices(
+          &battle, PKMN_PLAYER_P2, pkmn_result_p2(result), p2_choices.data(),
+          PKMN_GEN1_MAX_CHOICES);
+      auto c1 = p1_choices[seed % m];
       seed >>= 32;
-      c2 = p2_choices[seed % n];
+      auto c2 = p2_choices[seed % n];
+      if (mc.policy == MonteCarlo::Policy::greedy) {
+        c1 = greedy_choice(device, battle, 0, p1_choices.data(), m, c1);
+        c2 = greedy_choice(device, battle, 1, p2_choices.data(), n, c2);
+      }
       pkmn_gen1_battle_options_set(&options, nullptr, nullptr, nullptr);
       result = pkmn_gen1_battle_update(&battle, c1, c2, &options);
     }
@@ -495,6 +1665,52 @@ template <SearchOptions Options = default_search> struct Search {
     };
   }
 
+  // the move choice with the highest base power x effectiveness x stab against
+  // the foe's active pokemon. moves are scored from their data alone, since
+  // trying each one with the calc options would cost a battle update apiece.
+  // the uniform choice is kept with probability greedy_epsilon, and when no
+  // move does damage, so that rollouts still switch and vary
+  static constexpr float greedy_epsilon = .25;
+  static pkmn_choice greedy_choice(auto &device, const pkmn_gen1_battle &b,
+                                   const int player, const pkmn_choice *choices,
+                                   const size_t k,
+                                   const pkmn_choice uniform) noexcept {
+    using namespace PKMN::Data;
+    if (device.uniform() < greedy_epsilon) {
+      return uniform;
+    }
+    const auto &battle = PKMN::view(b);
+    const auto &active = battle.sides[player].active;
+    const auto &foe = battle.sides[1 - player].active;
+    // in the 2x units of the chart, so neutral is 4. mono types repeat
+    const auto effectiveness = [](const Type attacking, const uint8_t types) {
+      const auto &row = TYPE_CHART[static_cast<uint8_t>(attacking)];
+      const int first = static_cast<int>(row[types & 0xF]);
+      const int second = static_cast<int>(row[types >> 4]);
+      return ((types & 0xF) == (types >> 4)) ? 2 * first : first * second;
+    };
+    pkmn_choice best = uniform;
+    int best_score = 0;
+    for (size_t i = 0; i < k; ++i) {
+      const auto slot = choices[i] >> 2;
+      // move choices with a slot, not pass, switch or struggle
+      if ((choices[i] & 3) != 1 || slot == 0) {
+        continue;
+      }
+      const auto &data = move_data(active.moves[slot - 1].id);
+      const auto type = static_cast<uint8_t>(data.type);
+      const bool stab =
+          (type == (active.types & 0xF)) || (type == (active.types >> 4));
+      const int score =
+          data.bp * effectiveness(data.type, foe.types) * (stab ? 3 : 2);
+      if (score > best_score) {
+        best = choices[i];
+        best_score = score;
+      }
+    }
+    return best;
+  }
+
   inline auto solve_root_matrix_and_sample(auto &device, auto &params,
                                            auto &copy,
                                            const auto &output) noexcept {
@@ -502,9 +1718,8 @@ template <SearchOptions Options = default_search> struct Search {
     const bool periodic_solve = ((output.iterations % params.interval) == 0);
     if (periodic_solve || !initial_solve) {
       // get ucb matrices
-      std::array<int, 9 * 9> p1_ucb_matrix;
-      std::array<int, 9 * 9> p2_ucb_matrix;
-      constexpr int discretize_factor = 256;
+      std::array<float, 9 * 9> p1_ucb_matrix;
+      std::array<float, 9 * 9> p2_ucb_matrix;
       const float log_T = std::log(output.iterations);
       for (auto i = 0; i < output.p1.k; ++i) {
         for (auto j = 0; j < output.p2.k; ++j) {
@@ -522,28 +1737,35 @@ template <SearchOptions Options = default_search> struct Search {
                                    (output.visit_matrix[i][j] + 1));
           p1_entry += exploration;
           p2_entry -= exploration;
-          p1_ucb_matrix[i * output.p2.k + j] = p1_entry * discretize_factor;
-          p2_ucb_matrix[i * output.p2.k + j] = p2_entry * discretize_factor;
+          p1_ucb_matrix[i * output.p2.k + j] = p1_entry;
+          p2_ucb_matrix[i * output.p2.k + j] = p2_entry;
         }
       }
 
-      // solve and sample
-      std::array<float, 9 + 2> dummy;
-      LRSNash::FastInput p1_solve_input{
-          static_cast<int>(output.p1.k), static_cast<int>(output.p2.k),
-          p1_ucb_matrix.data(), discretize_factor};
-      LRSNash::FloatOneSumOutput p1_solve_output{p1_nash.data(), dummy.data(),
-                                                 0};
-      LRSNash::solve_fast(&p1_solve_input, &p1_solve_output);
-      LRSNash::FastInput p2_solve_input{
-          static_cast<int>(output.p1.k), static_cast<int>(output.p2.k),
-          p2_ucb_matrix.data(), discretize_factor};
-      LRSNash::FloatOneSumOutput p2_solve_output{dummy.data(), p2_nash.data(),
-                                                 0};
-      LRSNash::solve_fast(&p2_solve_input, &p2_solve_output);
+      // solve and sample, each warm started from the last solution. after
+      // the first solve an async search hands the matrices to the helper
+      if (async_solve && initial_solve) {
+        auto &matrices = async_solve->matrices.write_slot();
+        matrices = {p1_ucb_matrix, p2_ucb_matrix, output.p1.k, output.p2.k,
+                    {p1_nash, p2_nash}};
+        async_solve->matrices.publish();
+        async_solve->version.fetch_add(1, std::memory_order_release);
+        async_solve->version.notify_one();
+      } else {
+        auto dummy = p2_nash;
+        solve_matrix(p1_ucb_matrix.data(), output.p1.k, output.p2.k, p1_nash,
+                     dummy);
+        dummy = p1_nash;
+        solve_matrix(p2_ucb_matrix.data(), output.p1.k, output.p2.k, dummy,
+                     p2_nash);
+      }
 
       initial_solve = true;
     }
+    if (async_solve && async_solve->strategies.update()) {
+      p1_nash = async_solve->strategies.read().p1;
+      p2_nash = async_solve->strategies.read().p2;
+    }
 
     float p = device.uniform();
     for (auto i = 0; i < output.p1.k; ++i) {
@@ -565,40 +1787,117 @@ template <SearchOptions Options = default_search> struct Search {
     return std::pair<uint8_t, uint8_t>{p1_index, p2_index};
   }
 
-  // pkmn_gen1_battle_options_set with constexpr logic
+  // helper thread loop for async matrix ucb
+  void solve_root_matrices(AsyncSolve &async) const noexcept {
+    uint32_t seen = 0;
+    while (true) {
+      async.version.wait(seen, std::memory_order_acquire);
+      seen = async.version.load(std::memory_order_acquire);
+      if (async.done.load(std::memory_order_acquire)) {
+        return;
+      }
+      if (!async.matrices.update()) {
+        continue;
+      }
+      const auto &[p1_matrix, p2_matrix, m, n, warm] = async.matrices.read();
+      auto &strategies = async.strategies.write_slot();
+      strategies = warm;
+      auto dummy = strategies.p2;
+      solve_matrix(p1_matrix.data(), m, n, strategies.p1, dummy);
+      dummy = strategies.p1;
+      solve_matrix(p2_matrix.data(), m, n, dummy, strategies.p2);
+      async.strategies.publish();
+    }
+  }
+
+  // stats for the current hash, or scratch, see Table::probe. shared tables
+  // lock the shard for the lookup
+  auto &entry(auto &heap, const size_t depth, auto &scratch) noexcept {
+    const auto key = heap.hasher.last();
+    bool hit_old = false;
+    auto &stats = [&]() -> auto & {
+      if constexpr (is_shared_table<decltype(heap)>) {
+        const SpinLock lock{heap.table->lock(key)};
+        return heap.table->probe(key, depth, hit_old, scratch);
+      } else {
+        return heap.probe(key, depth, hit_old, scratch);
+      }
+    }();
+    ++probes;
+    reused += hit_old;
+    return stats;
+  }
+
+  // releases a table entry from entry(). shared tables must hold its lock
+  static void unpin(auto &heap, const auto &stats) noexcept {
+    if constexpr (is_shared_table<decltype(heap)>) {
+      heap.table->unpin(stats);
+    } else if constexpr (is_table<decltype(heap)>) {
+      heap.unpin(stats);
+    }
+  }
+
+  // unpin under the lock
+  static void release(auto &heap, const uint64_t key,
+                      const auto &stats) noexcept {
+    if constexpr (is_table<decltype(heap)>) {
+      const auto lock = guard(heap, key);
+      unpin(heap, stats);
+    }
+  }
+
+  // holds the bucket lock of a shared table entry, no-op for other heaps
+  static auto guard(auto &heap, const uint64_t key) noexcept {
+    if constexpr (is_shared_table<decltype(heap)>) {
+      return SpinLock{heap.table->lock(key)};
+    } else {
+      return NoLock{};
+    }
+  }
+
+  // pkmn_gen1_battle_options_set with the damage rolls for the depth
   void battle_options_set(pkmn_gen1_battle &battle, size_t depth) {
-    if constexpr (!Options.clamping) {
+    if ((root_rolls == 39) && (other_rolls == 39)) {
       pkmn_gen1_battle_options_set(&options, nullptr, nullptr, nullptr);
     } else {
       // last two bytes of battle rng
       const auto *rand = battle.bytes + PKMN::Layout::Offsets::Battle::rng + 6;
       auto *over = this->calc_options.overrides.bytes;
-      if constexpr (Options.rolls_same) {
-        over[0] = roll_byte<Options.root_rolls>(rand[0]);
-        over[8] = roll_byte<Options.root_rolls>(rand[1]);
-      } else {
-        if (depth == 0) {
-          over[0] = roll_byte<Options.root_rolls>(rand[0]);
-          over[8] = roll_byte<Options.root_rolls>(rand[1]);
-        } else {
-          over[0] = roll_byte<Options.other_rolls>(rand[0]);
-          over[8] = roll_byte<Options.other_rolls>(rand[1]);
-        }
-      }
+      const auto n_rolls = depth ? other_rolls : root_rolls;
+      over[0] = roll_byte(n_rolls, rand[0]);
+      over[8] = roll_byte(n_rolls, rand[1]);
       pkmn_gen1_battle_options_set(&options, nullptr, nullptr, &calc_options);
     }
   }
 
+  // chance actions of a root update made the way the search makes it, with
+  // the root damage rolls. trees are keyed on these rather than on the
+  // actions of the real update, whose rolls are not clamped
+  Obs root_obs(pkmn_gen1_battle battle,
+               const pkmn_gen1_chance_durations &durations,
+               const pkmn_choice c1, const pkmn_choice c2) noexcept {
+    chance_options.durations = durations;
+    pkmn_gen1_battle_options_set(&options, nullptr, &chance_options, nullptr);
+    battle_options_set(battle, 0);
+    pkmn_gen1_battle_update(&battle, c1, c2, &options);
+    return *reinterpret_cast<const Obs *>(
+        pkmn_gen1_battle_options_chance_actions(&options));
+  }
+
   // use battle seed to quickly compute a clamped damage roll
-  template <size_t n_rolls>
-  inline static constexpr uint8_t roll_byte(const uint8_t seed) noexcept {
+  static constexpr uint8_t roll_byte(const size_t n_rolls,
+                                     const uint8_t seed) noexcept {
     constexpr uint8_t lowest_roll{217};
     constexpr uint8_t middle_roll{236};
-    if constexpr (n_rolls == 1) {
+    switch (n_rolls) {
+    case 1:
       return middle_roll;
-    } else {
-      static_assert((n_rolls == 2) || (n_rolls == 3) || (n_rolls == 20));
-      constexpr uint8_t step = 38 / (n_rolls - 1);
+    case 39:
+      // no override
+      return 0;
+    default:
+      assert((n_rolls == 2) || (n_rolls == 3) || (n_rolls == 20));
+      const uint8_t step = 38 / (n_rolls - 1);
       return lowest_roll + step * (seed % n_rolls);
     }
   }
@@ -617,7 +1916,99 @@ template <SearchOptions Options = default_search> struct Search {
     return *pkmn_gen1_battle_options_chance_durations(&options);
   }
 
-  void process_output(Output &output, size_t beta_n = 0) noexcept {
+  // nash equilibrium of an m x n row major matrix, returns the nash value.
+  // the float solver reads nash1 and nash2 as its warm start.
+  // LRSNash convention: 2 extra entries needed for output denom, nash value
+  float solve_matrix(const float *matrix, const int m, const int n,
+                     std::array<float, 9 + 2> &nash1,
+                     std::array<float, 9 + 2> &nash2) const noexcept {
+    if (nash_tol > 0) {
+      const auto solution = Nash::regret_matching(matrix, m, n, nash1.data(),
+                                                  nash2.data(), nash_tol);
+      if (solution.gap <= nash_tol) {
+        return solution.value;
+      }
+    }
+    constexpr int discretize_factor = 256;
+    std::array<int, 9 * 9> discrete_matrix;
+    for (int i = 0; i < m * n; ++i) {
+      discrete_matrix[i] = matrix[i] * discretize_factor;
+    }
+    LRSNash::FastInput solve_input{m, n, discrete_matrix.data(),
+                                   discretize_factor};
+    LRSNash::FloatOneSumOutput solve_output{nash1.data(), nash2.data(), 0};
+    LRSNash::solve_fast(&solve_input, &solve_output);
+    return solve_output.value;
+  }
+
+  // nash equilibrium of the empirical root values, returns the nash value
+  float solve_root_matrix(const Output &output,
+                          std::array<float, 9 + 2> &nash1,
+                          std::array<float, 9 + 2> &nash2) const noexcept {
+    std::array<float, 9 * 9> matrix;
+    for (int i = 0; i < output.p1.k; ++i) {
+      for (int j = 0; j < output.p2.k; ++j) {
+        auto n = output.visit_matrix[i][j];
+        n += !n;
+        matrix[output.p2.k * i + j] = output.value_matrix[i][j] / n;
+      }
+    }
+    return solve_matrix(matrix.data(), output.p1.k, output.p2.k, nash1, nash2);
+  }
+
+  // applies the EarlyStop rules given the number of iterations left
+  bool stop_early(Output &output, const size_t remaining) noexcept {
+    std::array<size_t, 9> p1_visits{};
+    std::array<size_t, 9> p2_visits{};
+    for (int i = 0; i < output.p1.k; ++i) {
+      for (int j = 0; j < output.p2.k; ++j) {
+        p1_visits[i] += output.visit_matrix[i][j];
+        p2_visits[j] += output.visit_matrix[i][j];
+      }
+    }
+    const auto lead = [](const auto &visits, const int k) {
+      size_t first = 0;
+      size_t second = 0;
+      for (int i = 0; i < k; ++i) {
+        if (visits[i] > first) {
+          second = first;
+          first = visits[i];
+        } else if (visits[i] > second) {
+          second = visits[i];
+        }
+      }
+      return first - second;
+    };
+    if (lead(p1_visits, output.p1.k) > remaining &&
+        lead(p2_visits, output.p2.k) > remaining) {
+      output.stop = Stop::lead;
+      return true;
+    }
+
+    if (early_stop.stable) {
+      auto p1_nash = last_p1_nash;
+      auto p2_nash = last_p2_nash;
+      solve_root_matrix(output, p1_nash, p2_nash);
+      float change = 0;
+      for (int i = 0; i < output.p1.k; ++i) {
+        change = std::max(change, std::abs(p1_nash[i] - last_p1_nash[i]));
+      }
+      for (int j = 0; j < output.p2.k; ++j) {
+        change = std::max(change, std::abs(p2_nash[j] - last_p2_nash[j]));
+      }
+      last_p1_nash = p1_nash;
+      last_p2_nash = p2_nash;
+      stable_checks = (change < early_stop.tol) ? stable_checks + 1 : 0;
+      if (stable_checks >= early_stop.stable) {
+        output.stop = Stop::nash;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void process_output(Output &output, auto &device,
+                      const size_t beta_n = 0) noexcept {
     // prepare output, solve empirical root matrix if enabled
     // output.empirical_value = output.total_value / output.iterations;
     double total_value = 0;
@@ -625,28 +2016,19 @@ template <SearchOptions Options = default_search> struct Search {
     output.p1.empirical = {};
     output.p2.empirical = {};
 
-    constexpr int discretize_factor = 256;
-    std::array<int, 9 * 9> solve_matrix;
     for (int i = 0; i < output.p1.k; ++i) {
       for (int j = 0; j < output.p2.k; ++j) {
         total_value += output.value_matrix[i][j];
-        auto n = output.visit_matrix[i][j];
+        const auto n = output.visit_matrix[i][j];
         output.p1.empirical[i] += n;
         output.p2.empirical[j] += n;
-        n += !n;
-        solve_matrix[output.p2.k * i + j] =
-            output.value_matrix[i][j] / n * discretize_factor;
       }
     }
 
     output.empirical_value = total_value / output.iterations;
-    LRSNash::FastInput solve_input{static_cast<int>(output.p1.k),
-                                   static_cast<int>(output.p2.k),
-                                   solve_matrix.data(), discretize_factor};
-    // LRSNash convention: 2 extra entries needed for output denom, nash value
-    std::array<float, 9 + 2> nash1{}, nash2{};
-    LRSNash::FloatOneSumOutput solve_output{nash1.data(), nash2.data(), 0};
-    LRSNash::solve_fast(&solve_input, &solve_output);
+    auto nash1 = last_p1_nash;
+    auto nash2 = last_p2_nash;
+    output.nash_value = solve_root_matrix(output, nash1, nash2);
 
     for (int i = 0; i < output.p1.k; ++i) {
       output.p1.empirical[i] /= (float)output.iterations;
@@ -656,38 +2038,46 @@ template <SearchOptions Options = default_search> struct Search {
       output.p2.empirical[j] /= (float)output.iterations;
       output.p2.nash[j] = nash2[j];
     }
-    output.nash_value = solve_output.value;
 
     output.p1.beta = {};
     output.p2.beta = {};
 
-    // std::mt19937 rd{std::random_device{}()};
-    // for (auto k = 0; k < beta_n; ++k) {
-    //   for (int i = 0; i < output.p1.k; ++i) {
-    //     for (int j = 0; j < output.p2.k; ++j) {
-    //       auto n = output.visit_matrix[i][j];
-    //       double v = output.value_matrix[i][j];
-    //       if (n == 0) {
-    //         n = 1;
-    //         v = .5;
-    //       }
-    //       auto w = beta_sample(v, n, rd);
-    //       solve_matrix[output.p2.k * i + j] = w * discretize_factor;
-    //     }
-    //   }
-    //   LRSNash::FastInput solve_input{static_cast<int>(output.p1.k),
-    //                                  static_cast<int>(output.p2.k),
-    //                                  solve_matrix.data(), discretize_factor};
-    //   std::array<float, 9 + 2> nash1{}, nash2{};
-    //   LRSNash::FloatOneSumOutput solve_output{nash1.data(), nash2.data(), 0};
-    //   LRSNash::solve_fast(&solve_input, &solve_output);
-    //   for (auto i = 0; i < output.p1.k; ++i) {
-    //     output.p1.beta[i] += nash1[i] / beta_n;
-    //   }
-    //   for (auto i = 0; i < output.p2.k; ++i) {
-    //     output.p2.beta[i] += nash2[i] / beta_n;
-    //   }
-    // }
+    // average nash of beta_n matrices resampled from the beta posteriors of
+    // the root values. the samples are close to the empirical matrix, so the
+    // float solver warm started from its nash only needs a few iterations
+    if (!beta_n) {
+      return;
+    }
+    // seeded from the device so that searches stay reproducible
+    std::mt19937 rd{static_cast<std::mt19937::result_type>(
+        device.random_seed())};
+    const int k = output.p1.k * output.p2.k;
+    std::array<double, 9 * 9> alpha, n, samples;
+    for (int i = 0; i < output.p1.k; ++i) {
+      for (int j = 0; j < output.p2.k; ++j) {
+        const auto visits = output.visit_matrix[i][j];
+        // rounding can leave the value sum just above the visits
+        alpha[output.p2.k * i + j] =
+            visits ? std::min(output.value_matrix[i][j], double(visits)) : .5;
+        n[output.p2.k * i + j] = visits ? visits : 1;
+      }
+    }
+    const float tol = (nash_tol > 0) ? nash_tol : beta_tol;
+    std::array<float, 9 * 9> matrix;
+    for (size_t b = 0; b < beta_n; ++b) {
+      beta_samples(alpha.data(), n.data(), k, samples.data(), rd);
+      std::copy_n(samples.data(), k, matrix.data());
+      auto beta1 = nash1;
+      auto beta2 = nash2;
+      Nash::regret_matching(matrix.data(), output.p1.k, output.p2.k,
+                            beta1.data(), beta2.data(), tol);
+      for (int i = 0; i < output.p1.k; ++i) {
+        output.p1.beta[i] += beta1[i] / beta_n;
+      }
+      for (int j = 0; j < output.p2.k; ++j) {
+        output.p2.beta[j] += beta2[j] / beta_n;
+      }
+    }
   }
 };
 
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// bump allocator for trivially destructible objects. nothing is freed until
+// the arena is, which releases every block at once
+struct Arena {
+  static constexpr size_t block_size = 1 << 20;
+
+  std::vector<std::unique_ptr<std::byte[]>> blocks;
+  std::byte *head = nullptr;
+  size_t remaining = 0;
+  size_t allocated = 0;
+
+  template <typename T> T *allocate(const size_t n) {
+    static_assert(std::is_trivially_destructible_v<T>);
+    const size_t bytes = n * sizeof(T);
+    void *ptr = head;
+    if (!std::align(alignof(T), bytes, ptr, remaining)) {
+      const size_t size = std::max(block_size, bytes + alignof(T));
+      blocks.emplace_back(new std::byte[size]);
+      ptr = blocks.back().get();
+      remaining = size;
+      std::align(alignof(T), bytes, ptr, remaining);
+    }
+    head = static_cast<std::byte *>(ptr) + bytes;
+    remaining -= bytes;
+    allocated += bytes;
+    return static_cast<T *>(ptr);
+  }
+
+  void clear() noexcept {
+    blocks.clear();
+    head = nullptr;
+    remaining = 0;
+    allocated = 0;
+  }
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <immintrin.h>
+
+#include <cstdint>
+#include <limits>
+
+// first index of the largest (bonus[i] + scores[i]) / visits[i] for the first k
+// of 9 arms. the first 8 arms are one avx lane each and the 9th is scalar
+inline uint8_t ucb_argmax(const float *scores, const uint32_t *visits,
+                          const __m256 bonus, const float bonus_8,
+                          const uint8_t k) noexcept {
+  const __m256 s = _mm256_loadu_ps(scores);
+  const __m256 v = _mm256_cvtepi32_ps(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i *>(visits)));
+  __m256 a = _mm256_div_ps(_mm256_add_ps(bonus, s), v);
+
+  // lanes past k hold stale stats, they are never selected
+  const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256 valid = _mm256_castsi256_ps(
+      _mm256_cmpgt_epi32(_mm256_set1_epi32(k), lanes));
+  a = _mm256_blendv_ps(_mm256_set1_ps(-std::numeric_limits<float>::infinity()),
+                       a, valid);
+
+  // broadcast max
+  __m256 m = _mm256_max_ps(a, _mm256_permute2f128_ps(a, a, 1));
+  m = _mm256_max_ps(m, _mm256_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+  m = _mm256_max_ps(m, _mm256_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+  const int mask = _mm256_movemask_ps(_mm256_cmp_ps(a, m, _CMP_EQ_OQ));
+  uint8_t index = mask ? __builtin_ctz(mask) : 0;
+
+  if (k == 9) {
+    const float a_8 = (bonus_8 + scores[8]) / visits[8];
+    if (a_8 > _mm256_cvtss_f32(m)) {
+      index = 8;
+    }
+  }
+  return index;
+}
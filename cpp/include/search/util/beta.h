@@ -1,8 +1,13 @@
 #pragma once
 
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <random>
+
 template <class RNG> double gamma_sample(double a, RNG &rng) {
-  static std::normal_distribution<double> norm(0.0, 1.0);
-  static std::uniform_real_distribution<double> uni(0.0, 1.0);
+  static thread_local std::normal_distribution<double> norm(0.0, 1.0);
+  static thread_local std::uniform_real_distribution<double> uni(0.0, 1.0);
 
   if (a < 1.0) {
     // boost trick
@@ -37,6 +42,57 @@ template <class RNG> double beta_sample(double alpha, size_t N, RNG &rng) {
   return x / (x + y);
 }
 
+// count beta_sample draws at once, reusing the normals that the rejection
+// step did not consume. out[i] ~ Beta(alpha[i], N[i] - alpha[i])
+template <class RNG>
+void beta_samples(const double *alpha, const double *N, const size_t count,
+                  double *out, RNG &rng) {
+  constexpr size_t block = 32;
+  std::normal_distribution<double> norm(0.0, 1.0);
+  std::array<double, block> normals;
+  size_t next = block;
+  const auto normal = [&]() {
+    if (next == block) {
+      for (auto &x : normals) {
+        x = norm(rng);
+      }
+      next = 0;
+    }
+    return normals[next++];
+  };
+  const auto uniform = [&rng]() {
+    return std::generate_canonical<double, 53>(rng);
+  };
+  const auto gamma = [&](double a) {
+    // boost trick, as in gamma_sample
+    double scale = 1.0;
+    if (a < 1.0) {
+      scale = std::pow(uniform(), 1.0 / a);
+      a += 1.0;
+    }
+    const double d = a - 1.0 / 3.0;
+    const double c = 1.0 / std::sqrt(9.0 * d);
+    while (true) {
+      const double x = normal();
+      double v = 1.0 + c * x;
+      if (v <= 0) {
+        continue;
+      }
+      v = v * v * v;
+      const double u = uniform();
+      if (u < 1 - 0.0331 * x * x * x * x ||
+          std::log(u) < 0.5 * x * x + d * (1 - v + std::log(v))) {
+        return scale * d * v;
+      }
+    }
+  };
+  for (size_t i = 0; i < count; ++i) {
+    const double x = gamma(alpha[i]);
+    const double y = gamma(N[i] - alpha[i]);
+    out[i] = x / (x + y);
+  }
+}
+
 template <class RNG> double fast_beta(double alpha, size_t N, RNG &rng) {
   double beta = N - alpha;
   std::uniform_real_distribution<double> uni(0.0, 1.0);
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
 #pragma pack(push, 1)
 struct uint24_t {
   std::array<uint8_t, 3> _data;
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+namespace Nash {
+
+struct Solution {
+  float value;
+  // exploitability of the returned strategies
+  float gap;
+};
+
+// approximate equilibrium of the zero sum game with row player payoffs given
+// by the m x n row major matrix, using alternating regret matching+ with
+// linearly weighted averages. x and y are read as the warm start (all zeros
+// for uniform) and hold the average strategies on return. stops once the gap
+// is at most tol or after max_iterations
+inline Solution regret_matching(const float *matrix, const int m, const int n,
+                                float *x, float *y, const float tol,
+                                const size_t max_iterations = 1 << 12) {
+  constexpr size_t check_interval = 8;
+  std::array<float, 9> q1, q2, s1, s2, u1, u2;
+  std::array<float, 9> x_sum{}, y_sum{};
+  std::copy_n(x, m, q1.data());
+  std::copy_n(y, n, q2.data());
+
+  // current strategy from the regrets, uniform if there are none
+  const auto strategy = [](const float *q, float *s, const int k) {
+    float sum = 0;
+    for (int i = 0; i < k; ++i) {
+      sum += q[i];
+    }
+    for (int i = 0; i < k; ++i) {
+      s[i] = (sum > 0) ? q[i] / sum : 1.0f / k;
+    }
+  };
+  // payoffs of the row player's actions against y
+  const auto row_payoffs = [matrix, m, n](const float *y, float *u) {
+    for (int i = 0; i < m; ++i) {
+      float v = 0;
+      for (int j = 0; j < n; ++j) {
+        v += matrix[i * n + j] * y[j];
+      }
+      u[i] = v;
+    }
+  };
+  // payoffs of the column player's actions against x
+  const auto col_payoffs = [matrix, m, n](const float *x, float *u) {
+    for (int j = 0; j < n; ++j) {
+      u[j] = 0;
+    }
+    for (int i = 0; i < m; ++i) {
+      for (int j = 0; j < n; ++j) {
+        u[j] -= matrix[i * n + j] * x[i];
+      }
+    }
+  };
+  const auto regret = [](float *q, const float *s, const float *u,
+                         const int k) {
+    float ev = 0;
+    for (int i = 0; i < k; ++i) {
+      ev += s[i] * u[i];
+    }
+    for (int i = 0; i < k; ++i) {
+      q[i] = std::max(q[i] + u[i] - ev, 0.0f);
+    }
+  };
+
+  Solution solution{0, 1};
+  strategy(q2.data(), s2.data(), n);
+  for (size_t t = 1; t <= max_iterations; ++t) {
+    strategy(q1.data(), s1.data(), m);
+    row_payoffs(s2.data(), u1.data());
+    regret(q1.data(), s1.data(), u1.data(), m);
+    for (int i = 0; i < m; ++i) {
+      x_sum[i] += t * s1[i];
+    }
+
+    strategy(q1.data(), s1.data(), m);
+    col_payoffs(s1.data(), u2.data());
+    regret(q2.data(), s2.data(), u2.data(), n);
+    for (int j = 0; j < n; ++j) {
+      y_sum[j] += t * s2[j];
+    }
+    strategy(q2.data(), s2.data(), n);
+
+    if (t % check_interval && t != max_iterations) {
+      continue;
+    }
+    // the weights sum to the same total for both players
+    const float total = t * (t + 1) / 2.0f;
+    for (int i = 0; i < m; ++i) {
+      x[i] = x_sum[i] / total;
+    }
+    for (int j = 0; j < n; ++j) {
+      y[j] = y_sum[j] / total;
+    }
+    row_payoffs(y, u1.data());
+    col_payoffs(x, u2.data());
+    const float best_row = *std::max_element(u1.data(), u1.data() + m);
+    const float best_col = -*std::max_element(u2.data(), u2.data() + n);
+    float value = 0;
+    for (int i = 0; i < m; ++i) {
+      value += x[i] * u1[i];
+    }
+    solution = {value, best_row - best_col};
+    if (solution.gap <= tol) {
+      break;
+    }
+  }
+  return solution;
+}
+
+} // namespace Nash
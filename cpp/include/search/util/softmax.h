@@ -1,5 +1,9 @@
 #pragma once
 
+#include <immintrin.h>
+
+#include <algorithm>
+#include <array>
 #include <cmath>
 
 inline void softmax(auto *output, const auto *logits, auto k) {
@@ -24,4 +28,65 @@ inline void softmax(auto &forecast, const auto &gains, float eta) {
   for (auto i = 0; i < 9; ++i) {
     forecast[i] /= sum;
   }
-}
\ No newline at end of file
+}
+// exp for 8 floats, range reduced to 2^n * e^r with |r| <= ln(2) / 2 and a
+// degree 5 polynomial for e^r (relative error ~2e-7). underflow, including
+// -inf, is exactly 0
+inline __m256 fast_exp(__m256 x) noexcept {
+  const __m256 min = _mm256_set1_ps(-87.3f);
+  const __m256 underflow = _mm256_cmp_ps(x, min, _CMP_LT_OQ);
+  x = _mm256_min_ps(_mm256_max_ps(x, min), _mm256_set1_ps(88.3f));
+
+  const __m256 n = _mm256_round_ps(
+      _mm256_mul_ps(x, _mm256_set1_ps(1.44269504f)),
+      _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  // ln(2) in two parts so that r stays exact
+  __m256 r = _mm256_sub_ps(x, _mm256_mul_ps(n, _mm256_set1_ps(0.693359375f)));
+  r = _mm256_sub_ps(r, _mm256_mul_ps(n, _mm256_set1_ps(-2.12194440e-4f)));
+
+  __m256 y = _mm256_set1_ps(1.9875691500e-4f);
+  y = _mm256_add_ps(_mm256_mul_ps(y, r), _mm256_set1_ps(1.3981999507e-3f));
+  y = _mm256_add_ps(_mm256_mul_ps(y, r), _mm256_set1_ps(8.3334519073e-3f));
+  y = _mm256_add_ps(_mm256_mul_ps(y, r), _mm256_set1_ps(4.1665795894e-2f));
+  y = _mm256_add_ps(_mm256_mul_ps(y, r), _mm256_set1_ps(1.6666665459e-1f));
+  y = _mm256_add_ps(_mm256_mul_ps(y, r), _mm256_set1_ps(5.0000001201e-1f));
+  y = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(y, r), r),
+                    _mm256_add_ps(r, _mm256_set1_ps(1.0f)));
+
+  // scale by 2^n through the exponent bits
+  const __m256i pow2n = _mm256_slli_epi32(
+      _mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+  y = _mm256_mul_ps(y, _mm256_castsi256_ps(pow2n));
+  return _mm256_andnot_ps(underflow, y);
+}
+
+// exp3 policy (1 - alpha) * softmax(eta * gains) + alpha / k over all 9 arms,
+// with one vector exp for the first 8 and another for the last. the max gain
+// is subtracted first so the sum can't underflow
+inline void exp3_policy(std::array<float, 9> &policy,
+                        const std::array<float, 9> &gains, const float eta,
+                        const float one_minus_alpha,
+                        const float delta) noexcept {
+  const __m256 g = _mm256_loadu_ps(gains.data());
+  __m256 m = _mm256_max_ps(g, _mm256_permute2f128_ps(g, g, 1));
+  m = _mm256_max_ps(m, _mm256_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+  m = _mm256_max_ps(m, _mm256_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+  const float max = std::max(_mm256_cvtss_f32(m), gains[8]);
+
+  const __m256 e = _mm256_set1_ps(eta);
+  const __m256 y =
+      fast_exp(_mm256_mul_ps(_mm256_sub_ps(g, _mm256_set1_ps(max)), e));
+  const float y_8 =
+      _mm256_cvtss_f32(fast_exp(_mm256_set1_ps((gains[8] - max) * eta)));
+
+  __m128 sum = _mm_add_ps(_mm256_castps256_ps128(y),
+                          _mm256_extractf128_ps(y, 1));
+  sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+  sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+  const float scale = one_minus_alpha / (_mm_cvtss_f32(sum) + y_8);
+
+  _mm256_storeu_ps(policy.data(),
+                   _mm256_add_ps(_mm256_mul_ps(y, _mm256_set1_ps(scale)),
+                                 _mm256_set1_ps(delta)));
+  policy[8] = y_8 * scale + delta;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include <immintrin.h>
+
+// lock guard over a plain byte so that the structs holding the byte (tables,
+// buckets) stay trivially copyable
+struct SpinLock {
+  uint8_t &byte;
+
+  SpinLock(uint8_t &byte) noexcept : byte{byte} {
+    std::atomic_ref<uint8_t> lock{byte};
+    while (lock.exchange(1, std::memory_order_acquire)) {
+      while (lock.load(std::memory_order_relaxed)) {
+        _mm_pause();
+      }
+    }
+  }
+
+  SpinLock(const SpinLock &) = delete;
+
+  ~SpinLock() {
+    std::atomic_ref<uint8_t>{byte}.store(0, std::memory_order_release);
+  }
+};
+
+// stand-in when the heap is not shared between threads
+struct [[maybe_unused]] NoLock {};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// lock free hand off of the latest value from one writer to one reader. the
+// writer fills its back slot and swaps it with the middle one, the reader
+// swaps the middle slot into its front one when it holds a newer value. the
+// third slot means neither side ever waits for the other
+template <typename T> struct TripleBuffer {
+  static constexpr uint8_t fresh = 4;
+
+  std::array<T, 3> slots{};
+  // index of the middle slot, with the fresh bit set if it is unread
+  std::atomic<uint8_t> middle{1};
+  uint8_t back = 0;
+  uint8_t front = 2;
+
+  // writer
+  T &write_slot() noexcept { return slots[back]; }
+
+  void publish() noexcept {
+    back = middle.exchange(back | fresh, std::memory_order_acq_rel) & 3;
+  }
+
+  // reader, true if read() changed
+  bool update() noexcept {
+    if (!(middle.load(std::memory_order_relaxed) & fresh)) {
+      return false;
+    }
+    front = middle.exchange(front, std::memory_order_acq_rel) & 3;
+    return true;
+  }
+
+  const T &read() const noexcept { return slots[front]; }
+};
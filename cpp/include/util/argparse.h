@@ -30,17 +30,38 @@ struct TeamBuildingArgs : public argparse::Args {
         kwarg(B "bandit", "Bandit algorithm and parameters");                  \
                                                                                \
     WRAPPER<std::string> &A##matrix_ucb =                                      \
-        kwarg(B "matrix-ucb", "MatrixUCB start/interval/minimum/c")            \
+        kwarg(B "matrix-ucb", "MatrixUCB start/interval/minimum/c[/async]")    \
             .set_default("");                                                  \
                                                                                \
     WRAPPER<std::string> &A##eval =                                            \
-        kwarg(B "eval", "Eval mc/fp/<network-path>");                          \
+        kwarg(B "eval", "Eval mc[-greedy-t<turns>-n<rollouts>]/fp/<network>"); \
                                                                                \
     bool &A##use_discrete =                                                    \
         flag(B "use-discrete", "Enable Quantized discrete main subnet");       \
                                                                                \
     bool &A##use_table =                                                       \
         flag(B "use-table", "Use a transposition table instead of a tree");    \
+                                                                               \
+    std::optional<size_t> &A##table_mb =                                       \
+        kwarg(B "table-mb", "Transposition table size in megabytes");          \
+                                                                               \
+    std::optional<size_t> &A##tree_mb =                                        \
+        kwarg(B "tree-mb", "Tree memory cap in megabytes for all threads");    \
+                                                                               \
+    std::optional<size_t> &A##search_threads =                                 \
+        kwarg(B "search-threads", "Root parallel worker threads per search");  \
+                                                                               \
+    std::optional<size_t> &A##batch_size = kwarg(                              \
+        B "batch-size", "Leaves evaluated together by network searches");      \
+                                                                               \
+    std::optional<std::string> &A##search_stop = kwarg(                        \
+        B "search-stop", "Early stop checks/stable-checks/tolerance");         \
+                                                                               \
+    std::optional<float> &A##nash_tol = kwarg(                                 \
+        B "nash-tol", "Float root solver exploitability, 0 for exact");        \
+                                                                               \
+    std::optional<std::string> &A##rolls = kwarg(                              \
+        B "rolls", "Damage rolls <root>-<other> or <both>, e.g. 3-1");         \
   };
 
 #define MAKE_AGENT_POLICY_ARGS(NAME, BASE, WRAPPER, A, B)                      \
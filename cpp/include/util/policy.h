@@ -19,6 +19,17 @@ enum class Mode : char {
   beta = 'b',
 };
 
+// resamples for MCTS::Output::beta, only computed when the mode uses them
+inline size_t beta_samples(const std::string &mode) {
+  constexpr size_t samples = 10;
+  for (std::string_view word : Parse::split(mode, '-')) {
+    if (!word.empty() && static_cast<Mode>(word[0]) == Mode::beta) {
+      return samples;
+    }
+  }
+  return 0;
+}
+
 inline std::array<double, 9> get_policy(const auto &side, const auto &options) {
   const auto &prior = side.prior;
   const auto &empirical = side.empirical;
@@ -56,7 +67,6 @@ inline std::array<double, 9> get_policy(const auto &side, const auto &options) {
       break;
     }
     case Mode::beta: {
-      throw std::runtime_error{"RuntimePolicy: (b)eta mode disabled for now."};
       std::transform(beta.begin(), beta.end(), policy.begin(), policy.begin(),
                      [w](double b, double p) { return p + w * b; });
       break;
@@ -36,6 +36,9 @@ public:
 
   uint64_t uniform_64() noexcept { return uniform_64_(engine); }
 
+  // Uniform float in [0, 1) from the top 24 bits of one engine draw
+  float uniform_float() noexcept { return (engine() >> 8) * 0x1p-24f; }
+
   template <typename Container>
   uint32_t sample_pdf(const Container &input) noexcept {
     double p = uniform();
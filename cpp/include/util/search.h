@@ -1,15 +1,23 @@
 #pragma once
 
 #include <nn/battle/network.h>
+#include <search/bandit/cpucb.h>
+#include <search/bandit/cucb.h>
 #include <search/bandit/exp3.h>
 #include <search/bandit/pexp3.h>
+#include <search/bandit/prm.h>
 #include <search/bandit/pucb.h>
+#include <search/bandit/rm.h>
 #include <search/bandit/ucb.h>
 #include <search/bandit/ucb1.h>
 #include <search/mcts.h>
 #include <util/random.h>
 
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <utility>
 #include <variant>
 
 namespace RuntimeSearch {
@@ -18,17 +26,24 @@ struct Heap {
 
   template <typename... T>
   using BanditVariantT =
-      std::variant<std::monostate, MCTS::Node<T>..., MCTS::Table<T>...>;
+      std::variant<std::monostate, MCTS::Tree<T>..., MCTS::Table<T>...>;
 
   using BanditVariant =
       BanditVariantT<Exp3::JointBandit, PExp3::JointBandit, UCB::JointBandit,
-                     PUCB::JointBandit, UCB1::JointBandit>;
+                     PUCB::JointBandit, UCB1::JointBandit, CUCB::JointBandit,
+                     CPUCB::JointBandit, RM::JointBandit, PRM::JointBandit>;
 
   BanditVariant data;
 
   bool update(uint8_t i, uint8_t j, const MCTS::Obs &obs);
   std::string type() const noexcept;
   bool empty() const noexcept;
+
+  // a header of magic, version, variant index and type name followed by the
+  // tree or table. load fails on any mismatch, leaving an empty heap. a
+  // loaded tree can only be searched from the root it was saved at
+  bool save(const std::string &path) const;
+  bool load(const std::string &path);
 };
 
 struct AgentParams {
@@ -38,13 +53,52 @@ struct AgentParams {
   std::string matrix_ucb;
   bool discrete;
   bool table;
+  // transposition table size in megabytes
+  size_t table_mb = 64;
+  // tree memory cap in megabytes, 0 for none. root parallel workers each
+  // grow a tree, so they get an equal part of it
+  size_t tree_mb = 0;
+  // root parallel workers per search
+  size_t threads = 1;
+  // leaves evaluated together by network searches
+  size_t batch_size = 1;
+  // checks-stable-tol, see MCTS::EarlyStop. empty to run the full budget
+  std::string early_stop;
+  // target exploitability of the float root solver, 0 for exact LRSNash
+  float nash_tol = 0;
+  // damage rolls at the root and other depths, <root>-<other> or <both>.
+  // empty for MCTS::default_search
+  std::string rolls;
+  // beta posterior resamples of the root matrix averaged into the beta
+  // policy, see RuntimePolicy::beta_samples. 0 skips them
+  size_t beta_samples = 0;
 
   constexpr bool operator==(const AgentParams &) const = default;
 };
 
 struct Agent : AgentParams {
 
+  // iterations, deadline or stop flag
+  using Budget = std::variant<size_t, MCTS::Clock::time_point,
+                              std::atomic<bool> *>;
+  // a search with the bandit, heap, eval and rolls of the agent resolved. the
+  // beta resamples are passed per search like the budget
+  using Search = std::function<MCTS::Output(
+      mt19937 &, const MCTS::Input &, Heap &, Budget, size_t, MCTS::Output)>;
+
   std::unique_ptr<NN::Battle::NetworkBase> network_ptr{};
+  // time budgets also end here, so several runs can share one clock
+  std::optional<MCTS::Clock::time_point> deadline{};
+
+  // set by compile() along with the params and network it was built for.
+  // run() compiles again if any of them change, except for the budget and
+  // beta samples
+  Search search{};
+  AgentParams compiled_params{};
+  const NN::Battle::NetworkBase *compiled_network{};
+  // last budget string and its iterations or duration
+  std::pair<std::string, std::variant<size_t, MCTS::Clock::duration>>
+      parsed_budget{};
 
   Agent(const AgentParams &params) : AgentParams{params}, network_ptr{} {}
   Agent() = default;
@@ -55,15 +109,28 @@ struct Agent : AgentParams {
 
   bool is_monte_carlo() const {
     return eval.empty() || eval == "mc" || eval == "montecarlo" ||
-           eval == "monte-carlo";
+           eval == "monte-carlo" || eval.starts_with("mc-");
   }
   bool is_foul_play() const { return eval == "fp"; }
   bool is_network() const { return !is_monte_carlo() && !is_foul_play(); }
 
   void initialize_network(const pkmn_gen1_battle &b);
+
+  // parse the agent strings and pick the network type once, so that later
+  // runs go straight to the right MCTS::Search instantiation
+  void compile();
+  bool is_compiled();
+  Budget parse_budget(std::atomic<bool> *const flag);
+
+  // chance actions of an update as this agent's search sees them, for
+  // Heap::update after a real update of the same battle
+  MCTS::Obs root_obs(const pkmn_gen1_battle &battle,
+                     const pkmn_gen1_chance_durations &durations,
+                     pkmn_choice c1, pkmn_choice c2) const;
 };
 
 MCTS::Output run(mt19937 &device, const MCTS::Input &input, Heap &heap_variant,
-                 Agent &agent, MCTS::Output output = {}, bool *const flag = {});
+                 Agent &agent, MCTS::Output output = {},
+                 std::atomic<bool> *const flag = {});
 
 } // namespace RuntimeSearch
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <search/mcts.h>
 
 #include <chrono>
+#include <cmath>
 #include <iomanip>
 #include <sstream>
 #include <string>
@@ -80,7 +81,17 @@ inline auto output_string(const Output &output, const pkmn_gen1_battle &battle,
   };
 
   ss << "Iterations: " << output.iterations
-     << ", Time: " << output.duration.count() / 1000.0 << " ms\n";
+     << ", Time: " << output.duration.count() / 1000.0 << " ms";
+  if (output.stop == Stop::lead) {
+    ss << ", Stopped early: lead";
+  } else if (output.stop == Stop::nash) {
+    ss << ", Stopped early: nash";
+  }
+  if (output.nodes) {
+    ss << ", Nodes: " << output.nodes << " (" << (output.bytes >> 20)
+       << " MB)";
+  }
+  ss << '\n';
   ss << "Value: " << std::fixed << std::setprecision(3)
      << output.empirical_value << "\n";
   ss << '\n';
@@ -144,6 +155,80 @@ inline auto output_string(const Output &output, const pkmn_gen1_battle &battle,
   return ss.str();
 }
 
+// one line of json with the search stats and both players' policies
+inline std::string output_json(const Output &output, const auto &p1_labels,
+                               const auto &p2_labels) {
+  std::stringstream ss{};
+  ss << std::setprecision(6);
+
+  // json has no nan or inf
+  const auto print_num = [&ss](const auto x) {
+    if (std::isfinite(static_cast<double>(x))) {
+      ss << x;
+    } else {
+      ss << "null";
+    }
+  };
+  const auto print_arr = [&ss, &print_num](const auto &arr, size_t k) {
+    ss << '[';
+    for (size_t i = 0; i < k; ++i) {
+      ss << (i ? "," : "");
+      print_num(arr[i]);
+    }
+    ss << ']';
+  };
+  const auto print_labels = [&ss](const auto &labels, size_t k) {
+    ss << '[';
+    for (size_t i = 0; i < k; ++i) {
+      ss << (i ? ",\"" : "\"");
+      for (const char c : labels[i]) {
+        if (c == '"' || c == '\\') {
+          ss << '\\';
+        }
+        ss << c;
+      }
+      ss << '"';
+    }
+    ss << ']';
+  };
+  const auto side_json = [&](const Output::Side &side, const auto &labels) {
+    ss << "{\"k\":" << static_cast<int>(side.k) << ",\"labels\":";
+    print_labels(labels, side.k);
+    ss << ",\"choices\":[";
+    for (size_t i = 0; i < side.k; ++i) {
+      ss << (i ? "," : "") << static_cast<int>(side.choices[i]);
+    }
+    ss << "],\"prior\":";
+    print_arr(side.prior, side.k);
+    ss << ",\"empirical\":";
+    print_arr(side.empirical, side.k);
+    ss << ",\"nash\":";
+    print_arr(side.nash, side.k);
+    ss << '}';
+  };
+
+  constexpr const char *stops[]{"budget", "lead", "nash"};
+  ss << "{\"iterations\":" << output.iterations
+     << ",\"duration_us\":" << output.duration.count() << ",\"stop\":\""
+     << stops[static_cast<uint8_t>(output.stop)] << "\""
+     << ",\"nodes\":" << output.nodes << ",\"bytes\":" << output.bytes
+     << ",\"empirical_value\":";
+  print_num(output.empirical_value);
+  ss << ",\"nash_value\":";
+  print_num(output.nash_value);
+  ss << ",\"visits\":[";
+  for (size_t i = 0; i < output.p1.k; ++i) {
+    ss << (i ? "," : "");
+    print_arr(output.visit_matrix[i], output.p2.k);
+  }
+  ss << "],\"p1\":";
+  side_json(output.p1, p1_labels);
+  ss << ",\"p2\":";
+  side_json(output.p2, p2_labels);
+  ss << '}';
+  return ss.str();
+}
+
 inline std::string output_string(const MCTS::Output &output,
                                  const MCTS::Input &input) {
 
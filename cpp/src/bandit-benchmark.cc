@@ -0,0 +1,203 @@
+#include <search/bandit/cpucb.h>
+#include <search/bandit/cucb.h>
+#include <search/bandit/exp3.h>
+#include <search/bandit/pexp3.h>
+#include <search/bandit/prm.h>
+#include <search/bandit/pucb.h>
+#include <search/bandit/rm.h>
+#include <search/bandit/ucb.h>
+#include <search/bandit/ucb1.h>
+#include <util/argparse.h>
+#include <util/random.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+// Times the bandit calls outside of a search. Each bandit is run on a pool of
+// nodes with k arms for both players, for every k in 1..9 and for k = 0, which
+// stands for a random k per player and node. The rewards come from a fixed
+// mean per node and pair of arms. One json line is printed per bandit, k and
+// call, with the average ns per call and the size of the joint bandit
+
+struct ProgramArgs : public argparse::Args {
+  std::optional<uint64_t> &seed = kwarg("seed", "Global program seed");
+  size_t &iterations = kwarg("iterations", "Calls timed per bandit, k and call")
+                           .set_default(1 << 20);
+  size_t &nodes = kwarg("nodes", "Bandits in the pool the calls cycle through")
+                      .set_default(1 << 10);
+  std::string &bandit =
+      kwarg("bandit", "Only time this bandit, e.g. ucb").set_default("");
+  std::string &rewards =
+      kwarg("rewards", "Reward stream bernoulli/uniform, uniform is the "
+                       "mean plus noise in [-.25, .25]")
+          .set_default("bernoulli");
+};
+
+using Clock = std::chrono::high_resolution_clock;
+
+struct Node {
+  uint8_t m;
+  uint8_t n;
+  // p1 value of each pair of arms is (a[i] + b[j]) / 2
+  std::array<float, 9> a;
+  std::array<float, 9> b;
+  std::array<float, 9> p1_logits;
+  std::array<float, 9> p2_logits;
+};
+
+struct Bench {
+  const ProgramArgs &args;
+  mt19937 device;
+  std::vector<Node> nodes;
+
+  void make_nodes(const uint8_t k) {
+    nodes.resize(args.nodes);
+    for (auto &node : nodes) {
+      node.m = k ? k : 1 + device.random_int(9);
+      node.n = k ? k : 1 + device.random_int(9);
+      for (auto i = 0; i < 9; ++i) {
+        node.a[i] = device.uniform_float();
+        node.b[i] = device.uniform_float();
+        node.p1_logits[i] = 4 * device.uniform_float() - 2;
+        node.p2_logits[i] = 4 * device.uniform_float() - 2;
+      }
+    }
+  }
+
+  float value(const Node &node, const auto &outcome) {
+    const float mean =
+        (node.a[outcome.p1.index] + node.b[outcome.p2.index]) / 2;
+    if (args.rewards == "uniform") {
+      return std::clamp(mean + (device.uniform_float() - .5f) / 2, 0.f, 1.f);
+    }
+    return device.uniform_float() < mean;
+  }
+
+  void print(const std::string &name, const uint8_t k, const std::string &call,
+             const Clock::duration duration, const size_t calls,
+             const size_t bytes) const {
+    const double ns =
+        std::chrono::duration<double, std::nano>(duration).count() / calls;
+    std::cout << "{\"bandit\":\"" << name << "\",\"k\":" << int(k)
+              << ",\"call\":\"" << call << "\",\"ns\":" << ns
+              << ",\"calls\":" << calls << ",\"bytes\":" << bytes << "}"
+              << std::endl;
+  }
+
+  template <typename JointBandit>
+  void run(const std::string &name,
+           const typename JointBandit::Params &params) {
+    if (!args.bandit.empty() && args.bandit != name) {
+      return;
+    }
+    constexpr bool contextual = requires(JointBandit bandit) {
+      bandit.softmax_logits(params, nullptr, nullptr);
+    };
+
+    for (uint8_t k = 0; k <= 9; ++k) {
+      make_nodes(k);
+      std::vector<JointBandit> bandits(nodes.size());
+      std::vector<typename JointBandit::JointOutcome> outcomes(nodes.size());
+      const size_t rounds =
+          std::max(args.iterations / nodes.size(), size_t{1});
+      const size_t calls = rounds * nodes.size();
+      Clock::duration init{}, softmax_logits{}, select{}, update{};
+
+      for (size_t r = 0; r < rounds; ++r) {
+        const auto start = Clock::now();
+        for (size_t j = 0; j < nodes.size(); ++j) {
+          bandits[j].init(nodes[j].m, nodes[j].n);
+        }
+        init += Clock::now() - start;
+      }
+      if constexpr (contextual) {
+        for (size_t r = 0; r < rounds; ++r) {
+          const auto start = Clock::now();
+          for (size_t j = 0; j < nodes.size(); ++j) {
+            bandits[j].softmax_logits(params, nodes[j].p1_logits.data(),
+                                      nodes[j].p2_logits.data());
+          }
+          softmax_logits += Clock::now() - start;
+        }
+      }
+      // the rewards are drawn between the timed passes
+      for (size_t r = 0; r < rounds; ++r) {
+        auto start = Clock::now();
+        for (size_t j = 0; j < nodes.size(); ++j) {
+          bandits[j].select(device, params, outcomes[j]);
+        }
+        select += Clock::now() - start;
+        for (size_t j = 0; j < nodes.size(); ++j) {
+          auto &outcome = outcomes[j];
+          outcome.p1.value = value(nodes[j], outcome);
+          outcome.p2.value = 1 - outcome.p1.value;
+        }
+        start = Clock::now();
+        for (size_t j = 0; j < nodes.size(); ++j) {
+          bandits[j].update(outcomes[j]);
+        }
+        update += Clock::now() - start;
+      }
+
+      constexpr auto bytes = sizeof(JointBandit);
+      print(name, k, "init", init, calls, bytes);
+      if constexpr (contextual) {
+        print(name, k, "softmax_logits", softmax_logits, calls, bytes);
+      }
+      print(name, k, "select", select, calls, bytes);
+      print(name, k, "update", update, calls, bytes);
+    }
+  }
+};
+
+int main(int argc, char **argv) {
+
+  auto args = argparse::parse<ProgramArgs>(argc, argv);
+
+  if (!args.seed.has_value()) {
+    args.seed.emplace(std::random_device{}());
+  }
+  if (args.nodes == 0) {
+    std::cerr << "--nodes must be positive." << std::endl;
+    return 1;
+  }
+  if (args.rewards != "bernoulli" && args.rewards != "uniform") {
+    std::cerr << "Could not parse rewards: " << args.rewards << std::endl;
+    return 1;
+  }
+
+  Bench bench{args, mt19937{static_cast<std::mt19937::result_type>(
+                        args.seed.value())}};
+
+  const float gamma = .1;
+  const float alpha = .05;
+  const Exp3::Bandit::Params exp3_params{.gamma = gamma,
+                                         .one_minus_gamma = (1 - gamma),
+                                         .alpha = alpha,
+                                         .one_minus_alpha = (1 - alpha)};
+  const PExp3::Bandit::Params pexp3_params{.gamma = gamma,
+                                           .one_minus_gamma = (1 - gamma),
+                                           .alpha = alpha,
+                                           .one_minus_alpha = (1 - alpha)};
+
+  bench.run<Exp3::JointBandit>("exp3", exp3_params);
+  bench.run<PExp3::JointBandit>("pexp3", pexp3_params);
+  bench.run<UCB::JointBandit>("ucb", {.c = 1});
+  bench.run<PUCB::JointBandit>("pucb", {.c = 1});
+  bench.run<UCB1::JointBandit>("ucb1", {.c = 1});
+  bench.run<CUCB::JointBandit>("cucb", {.c = 1});
+  bench.run<CPUCB::JointBandit>("cpucb", {.c = 1});
+  bench.run<RM::JointBandit>("rm", {.gamma = gamma,
+                                    .one_minus_gamma = (1 - gamma)});
+  bench.run<PRM::JointBandit>("prm", {.gamma = gamma,
+                                      .one_minus_gamma = (1 - gamma),
+                                      .prior_weight = 1});
+
+  return 0;
+}
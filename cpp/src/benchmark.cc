@@ -16,7 +16,14 @@ int benchmark(int argc, char **argv) {
       .eval = args.eval.value_or("mc"),
       .matrix_ucb = args.matrix_ucb.value_or(""),
       .discrete = args.use_discrete,
-      .table = args.use_table};
+      .table = args.use_table,
+      .table_mb = args.table_mb.value_or(64),
+      .tree_mb = args.tree_mb.value_or(0),
+      .threads = args.search_threads.value_or(1),
+      .batch_size = args.batch_size.value_or(1),
+      .early_stop = args.search_stop.value_or(""),
+      .nash_tol = args.nash_tol.value_or(0),
+      .rolls = args.rolls.value_or("")};
 
   auto agent = RuntimeSearch::Agent{agent_params};
 
@@ -46,6 +53,12 @@ int benchmark(int argc, char **argv) {
     std::cout << us << "µs." << std::endl;
   }
   std::cout << output.iterations << " iterations." << std::endl;
+  if (us > 0) {
+    std::cout << (output.iterations * 1000000 / us) << " iterations/s."
+              << std::endl;
+  }
+  std::cout << (MCTS::default_search.iterative ? "iterative" : "recursive")
+            << " descent." << std::endl;
 
   return 0;
 }
@@ -4,6 +4,7 @@
 #include <util/random.h>
 #include <util/search.h>
 
+#include <atomic>
 #include <chrono>
 #include <csignal>
 #include <iostream>
@@ -13,9 +14,20 @@ struct ProgramArgs : public ChallArgs {
   std::optional<uint64_t> &seed = kwarg("seed", "Global program seed");
   bool &use_budget = flag("--use-budget",
                           "Use --budget value instead of ctrl+z to end search");
+  bool &ponder = flag("--ponder", "Keep searching while waiting for input and "
+                                  "reuse the matching child after an update");
+  std::optional<std::string> &load_heap =
+      kwarg("load-heap", "Search tree/table to resume the first search from");
+  std::optional<std::string> &save_heap =
+      kwarg("save-heap", "Path the search tree/table is saved to each turn");
 };
 
-bool search_flag = true;
+// atomic so the searches see the signal handler and main thread stores.
+// lock free, so the handler may store to it
+std::atomic<bool> search_flag{true};
+// stops the background search once input arrives, not by ctrl+z
+std::atomic<bool> ponder_flag{true};
+static_assert(std::atomic<bool>::is_always_lock_free);
 
 void handle_suspend(int signal) {
   std::cout << "Search Suspended." << std::endl;
@@ -38,9 +50,18 @@ int main(int argc, char **argv) {
       .eval = args.eval.value_or("mc"),
       .matrix_ucb = args.matrix_ucb.value_or(""),
       .discrete = args.use_discrete,
-      .table = args.use_table};
+      .table = args.use_table,
+      .table_mb = args.table_mb.value_or(64),
+      .tree_mb = args.tree_mb.value_or(0),
+      .threads = args.search_threads.value_or(1),
+      .batch_size = args.batch_size.value_or(1),
+      .early_stop = args.search_stop.value_or(""),
+      .nash_tol = args.nash_tol.value_or(0),
+      .rolls = args.rolls.value_or(""),
+      .beta_samples =
+          RuntimePolicy::beta_samples(args.policy_mode.value_or("x"))};
   auto agent = RuntimeSearch::Agent{agent_params};
-  bool *const flag = args.use_budget ? nullptr : &search_flag;
+  std::atomic<bool> *const flag = args.use_budget ? nullptr : &search_flag;
 
   if (!args.seed.has_value()) {
     args.seed.emplace(std::random_device{}());
@@ -75,6 +96,15 @@ int main(int argc, char **argv) {
   chance_options.durations = input.durations;
   pkmn_gen1_battle_options_set(&options, nullptr, &chance_options, nullptr);
 
+  RuntimeSearch::Heap heap{};
+  // pondered heaps reused after an update, to measure the reroot misses
+  size_t kept = 0;
+  size_t updates = 0;
+  if (args.load_heap && !heap.load(args.load_heap.value())) {
+    std::cerr << "Could not load heap: " << args.load_heap.value() << std::endl;
+    return 1;
+  }
+
   while (!pkmn_result_type(input.result)) {
     std::cout << "\nBattle:" << std::endl;
     std::cout << PKMN::battle_data_to_string(input.battle, input.durations);
@@ -96,7 +126,6 @@ int main(int argc, char **argv) {
 
     std::cout << "Starting search. (Ctrl + Z) to pause." << std::endl;
 
-    RuntimeSearch::Heap heap{};
     MCTS::Output output{};
 
     int p1_index = -1;
@@ -108,8 +137,27 @@ int main(int argc, char **argv) {
       std::cout << output_string(output, input.battle, p1_labels, p2_labels);
       std::cout << "Input: P1 index (P2 index); Negative index = sample."
                 << std::endl;
+
+      // search the same root until the input arrives
+      std::thread ponder{};
+      MCTS::Output ponder_output{};
+      if (args.ponder) {
+        ponder_flag = true;
+        ponder = std::thread{[&] {
+          ponder_output = RuntimeSearch::run(device, input, heap, agent,
+                                             output, &ponder_flag);
+        }};
+      }
       std::string line;
-      if (!std::getline(std::cin, line)) {
+      const bool read = static_cast<bool>(std::getline(std::cin, line));
+      if (ponder.joinable()) {
+        ponder_flag = false;
+        ponder.join();
+        std::cout << "Pondered " << ponder_output.iterations - output.iterations
+                  << " iterations." << std::endl;
+        output = ponder_output;
+      }
+      if (!read) {
         std::cerr << "Input stream error.\n";
         continue;
       }
@@ -140,6 +188,11 @@ int main(int argc, char **argv) {
           RuntimePolicy::process_and_sample(device, output.p2, policy_options);
     }
 
+    if (args.save_heap && !heap.save(args.save_heap.value())) {
+      std::cerr << "Could not save heap: " << args.save_heap.value()
+                << std::endl;
+    }
+
     auto c1 = p1_choices[p1_index];
     auto c2 = p2_choices[p2_index];
 
@@ -147,8 +200,25 @@ int main(int argc, char **argv) {
               << p2_labels[p2_index] << std::endl;
     std::this_thread::sleep_for(std::chrono::seconds(1));
 
+    // the child is found by the actions of the update with the search's
+    // damage rolls, not those of the real update
+    const auto obs = agent.root_obs(input.battle, input.durations, c1, c2);
     input.result = PKMN::update(input.battle, c1, c2, options);
     input.durations = *pkmn_gen1_battle_options_chance_durations(&options);
+
+    if (args.ponder) {
+      ++updates;
+      if (heap.update(p1_index, p2_index, obs)) {
+        ++kept;
+        std::cout << "Kept the search heap";
+      } else {
+        std::cout << "Dropped the search heap";
+      }
+      std::cout << ", kept " << kept << " of " << updates << " times."
+                << std::endl;
+    } else {
+      heap = RuntimeSearch::Heap{};
+    }
   }
 
   std::cout << "\nBattle:" << std::endl;
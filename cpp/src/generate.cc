@@ -114,6 +114,8 @@ std::atomic<size_t> frame_counter{};
 std::atomic<size_t> traj_counter{};
 std::atomic<size_t> update_counter{};
 std::atomic<size_t> update_with_node_counter{};
+std::atomic<size_t> probe_counter{};
+std::atomic<size_t> reuse_counter{};
 // teams
 TeamBuilding::Provider provider;
 MatchupMatrix matchup_matrix;
@@ -250,6 +252,13 @@ void generate(const ProgramArgs *args_ptr) {
         .matrix_ucb = args.matrix_ucb,
         .discrete = args.use_discrete,
         .table = args.use_table,
+        .table_mb = args.table_mb.value_or(64),
+        .tree_mb = args.tree_mb.value_or(0),
+        .threads = args.search_threads.value_or(1),
+        .batch_size = args.batch_size.value_or(1),
+        .early_stop = args.search_stop.value_or(""),
+        .nash_tol = args.nash_tol.value_or(0),
+        .rolls = args.rolls.value_or(""),
     };
     auto agent = RuntimeSearch::Agent{agent_params};
     if (agent.is_network()) {
@@ -297,9 +306,12 @@ void generate(const ProgramArgs *args_ptr) {
         policy_options.mode =
             use_fast ? args.fast_policy_mode.value_or(args.policy_mode)
                      : args.policy_mode;
+        agent.beta_samples = RuntimePolicy::beta_samples(policy_options.mode);
         MCTS::Output output{};
 
         output = RuntimeSearch::run(device, battle_data, heap, agent);
+        RuntimeData::probe_counter.fetch_add(output.probes);
+        RuntimeData::reuse_counter.fetch_add(output.reused);
         if (battle_length == 0) {
           p1_matchup = output.empirical_value;
           p2_matchup = 1 - output.empirical_value;
@@ -414,6 +426,11 @@ void print_thread_fn(const ProgramArgs *args_ptr) {
           (double)RuntimeData::update_with_node_counter.load() /
           (double)RuntimeData::update_counter.load();
       std::cout << "keep node ratio: " << keep_node_ratio << std::endl;
+      if (const auto probes = RuntimeData::probe_counter.load()) {
+        double reuse_hit_rate =
+            (double)RuntimeData::reuse_counter.load() / (double)probes;
+        std::cout << "reuse hit rate: " << reuse_hit_rate << std::endl;
+      }
     }
     if (args.max_battles > 0) {
       const auto progress = (double)frames_more / args.max_battles * 100;
@@ -441,7 +441,9 @@ PYBIND11_MODULE(pyoak, m) {
   py::class_<RuntimeSearch::Heap>(m, "Heap")
       .def(py::init<>())
       .def("empty", &RuntimeSearch::Heap::empty)
-      .def("type", &RuntimeSearch::Heap::type);
+      .def("type", &RuntimeSearch::Heap::type)
+      .def("save", &RuntimeSearch::Heap::save)
+      .def("load", &RuntimeSearch::Heap::load);
 
   py::class_<RuntimeSearch::Agent>(m, "Agent")
       .def(py::init<>())
@@ -450,7 +452,15 @@ PYBIND11_MODULE(pyoak, m) {
       .def_readwrite("eval", &RuntimeSearch::Agent::eval)
       .def_readwrite("matrix_ucb", &RuntimeSearch::Agent::matrix_ucb)
       .def_readwrite("discrete", &RuntimeSearch::Agent::discrete)
-      .def_readwrite("table", &RuntimeSearch::Agent::table);
+      .def_readwrite("table", &RuntimeSearch::Agent::table)
+      .def_readwrite("table_mb", &RuntimeSearch::Agent::table_mb)
+      .def_readwrite("tree_mb", &RuntimeSearch::Agent::tree_mb)
+      .def_readwrite("threads", &RuntimeSearch::Agent::threads)
+      .def_readwrite("batch_size", &RuntimeSearch::Agent::batch_size)
+      .def_readwrite("early_stop", &RuntimeSearch::Agent::early_stop)
+      .def_readwrite("nash_tol", &RuntimeSearch::Agent::nash_tol)
+      .def_readwrite("rolls", &RuntimeSearch::Agent::rolls)
+      .def_readwrite("beta_samples", &RuntimeSearch::Agent::beta_samples);
   py::class_<MCTS::Input>(m, "Input").def(py::init<>());
 
   m.def(
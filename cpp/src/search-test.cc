@@ -3,13 +3,31 @@
 #include <util/random.h>
 #include <util/search.h>
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
 #include <exception>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
 
 struct ProgramArgs : public BenchmarkArgs {};
 
 constexpr float small = .03;
 
+void check(const bool condition, const std::string &message) {
+  if (!condition) {
+    std::cerr << message << std::endl;
+    throw std::runtime_error{""};
+  }
+}
+
 struct Test {
   std::string position;
   float expected;
@@ -28,7 +46,13 @@ struct Test {
         .bandit = args.bandit.value_or("exp3-1.0-0.1"),
         .eval = args.eval.value_or("mc"),
         .matrix_ucb = args.matrix_ucb.value_or(""),
-        .discrete = args.use_discrete};
+        .discrete = args.use_discrete,
+        .tree_mb = args.tree_mb.value_or(0),
+        .threads = args.search_threads.value_or(1),
+        .batch_size = args.batch_size.value_or(1),
+        .early_stop = args.search_stop.value_or(""),
+        .nash_tol = args.nash_tol.value_or(0),
+        .rolls = args.rolls.value_or("")};
     auto agent = RuntimeSearch::Agent{agent_params};
     auto output = RuntimeSearch::run(device, battle_data, heap, agent);
     bool success = std::abs(output.empirical_value - expected) <= error;
@@ -108,9 +132,578 @@ void sleep(const auto &args) {
   }(args);
 }
 
+// entries held by a descent are never replaced, a full bucket returns the
+// caller's scratch entry instead. a table of one bucket makes every key probe
+// the same slots
+void table_pins() {
+  using Table = MCTS::Table<UCB::JointBandit>;
+  mt19937 device{std::random_device{}()};
+  Table table{device, 0};
+  bool reused;
+  Table::Stats scratch;
+  const auto key = [](const uint64_t tag) { return tag << 32; };
+
+  std::array<Table::Stats *, Table::bucket_size> held;
+  for (size_t i = 0; i < Table::bucket_size; ++i) {
+    held[i] = &table.probe(key(i + 1), 0, reused, scratch);
+  }
+  const auto stored = [&](const Table::Stats &stats) {
+    return std::find(held.begin(), held.end(), &stats) != held.end();
+  };
+  auto &unstored = table.probe(key(100), 0, reused, scratch);
+  check(&unstored == &scratch, "table pins: replaced a pinned entry");
+  // another descent gets its own
+  Table::Stats other_scratch;
+  check(&table.probe(key(101), 0, reused, other_scratch) == &other_scratch,
+        "table pins: shared a scratch entry");
+  check(&table.probe(key(1), 0, reused, scratch) == held[0],
+        "table pins: lost a pinned entry");
+
+  table.unpin(*held[3]);
+  check(&table.probe(key(100), 0, reused, scratch) == held[3],
+        "table pins: did not replace the unpinned entry");
+  check(!stored(table.probe(key(4), 0, reused, scratch)),
+        "table pins: replaced a pinned entry");
+}
+
+// a full bucket replaces an entry from an earlier generation first, then the
+// least probed entry and the deepest one on ties
+void table_replacement() {
+  using Table = MCTS::Table<UCB::JointBandit>;
+  mt19937 device{std::random_device{}()};
+  Table table{device, 0};
+  bool reused;
+  Table::Stats scratch;
+  const auto get = [&](const uint64_t tag, const size_t depth) {
+    auto &stats = table.probe(tag << 32, depth, reused, scratch);
+    table.unpin(stats);
+    return &stats;
+  };
+
+  std::array<Table::Stats *, Table::bucket_size> slots;
+  for (size_t i = 0; i < Table::bucket_size; ++i) {
+    slots[i] = get(i + 1, i);
+  }
+  for (uint64_t tag = 1; tag <= 6; ++tag) {
+    check(get(tag, 0) == slots[tag - 1], "table replacement: lost an entry");
+  }
+  // tags 7 and 8 were probed once, 8 is deeper
+  check(get(9, 0) == slots[7], "table replacement: kept the deeper entry");
+  check(get(10, 0) == slots[6], "table replacement: kept the deeper entry");
+
+  table.age();
+  get(9, 0);
+  check(reused, "table replacement: entry not marked as reused");
+  get(9, 0);
+  check(!reused, "table replacement: entry reused twice");
+  get(10, 0);
+  // 9 and 10 have the fewest probes but are the only current entries
+  check(get(11, 0) == slots[5],
+        "table replacement: kept an entry of an earlier generation");
+
+  // a full cycle of the 8 bit generation must not make 11 current again
+  for (size_t i = 0; i < 256; ++i) {
+    table.age();
+  }
+  get(11, 0);
+  check(reused, "table replacement: generation wrapped");
+}
+
+// the float solver reaches its target on random games and its value is within
+// that gap of the exact LRSNash value
+void nash_solvers() {
+  constexpr float tol = 1e-3;
+  constexpr int discretize_factor = 256;
+  mt19937 device{std::random_device{}()};
+  for (int m = 1; m <= 9; ++m) {
+    for (int n = 1; n <= 9; ++n) {
+      // multiples of 1 / 256 so both solvers get the same game
+      std::array<float, 9 * 9> matrix;
+      std::array<int, 9 * 9> discrete_matrix;
+      for (int i = 0; i < m * n; ++i) {
+        discrete_matrix[i] = device.random_int(discretize_factor + 1);
+        matrix[i] = float(discrete_matrix[i]) / discretize_factor;
+      }
+      std::array<float, 9 + 2> x{}, y{};
+      const auto solution = Nash::regret_matching(matrix.data(), m, n, x.data(),
+                                                  y.data(), tol, 1 << 16);
+
+      std::array<float, 9 + 2> nash1, nash2;
+      LRSNash::FastInput input{m, n, discrete_matrix.data(),
+                               discretize_factor};
+      LRSNash::FloatOneSumOutput output{nash1.data(), nash2.data(), 0};
+      LRSNash::solve_fast(&input, &output);
+
+      const auto game = std::to_string(m) + "x" + std::to_string(n);
+      check(solution.gap <= tol, "nash solvers: missed the target on " + game);
+      check(std::abs(solution.value - output.value) <= solution.gap + 1e-4f,
+            "nash solvers: values differ on " + game);
+    }
+  }
+}
+
+// network with random weights, read from the format of a network file
+NN::Battle::Network random_network(mt19937 &device) {
+  namespace Default = NN::Battle::Default;
+  std::stringstream stream;
+  const auto layer = [&](const uint32_t in_dim, const uint32_t out_dim) {
+    stream.write(reinterpret_cast<const char *>(&in_dim), sizeof(in_dim));
+    stream.write(reinterpret_cast<const char *>(&out_dim), sizeof(out_dim));
+    const float k = 1 / std::sqrt(float(in_dim));
+    for (size_t i = 0; i < size_t{out_dim} * (in_dim + 1); ++i) {
+      const float x = (2 * device.uniform_float() - 1) * k;
+      stream.write(reinterpret_cast<const char *>(&x), sizeof(x));
+    }
+  };
+  layer(Encode::Battle::Pokemon::n_dim, Default::pokemon_hidden_dim);
+  layer(Default::pokemon_hidden_dim, Default::pokemon_out_dim);
+  layer(Encode::Battle::ActivePokemon::n_dim, Default::active_hidden_dim);
+  layer(Default::active_hidden_dim, Default::active_out_dim);
+  layer(2 * Default::side_out_dim, Default::hidden_dim);
+  layer(Default::hidden_dim, Default::hidden_dim);
+  layer(Default::hidden_dim, Default::value_hidden_dim);
+  layer(Default::value_hidden_dim, 1);
+  for (auto player = 0; player < 2; ++player) {
+    layer(Default::hidden_dim, Default::policy_hidden_dim);
+    layer(Default::policy_hidden_dim, Encode::Battle::Policy::n_dim);
+  }
+  NN::Battle::Network network;
+  check(network.read_parameters(stream), "random network: bad parameters");
+  return network;
+}
+
+// batched leaves get the same values and priors as leaves evaluated one at a
+// time
+void batch_leaves() {
+  constexpr float tol = 1e-4;
+  const uint64_t seed = std::random_device{}();
+  mt19937 device{seed};
+  auto network = random_network(device);
+  auto [battle, durations] = Parse::parse_battle(
+      "starmie surf thunderbolt recover; snorlax bodyslam earthquake | "
+      "tauros bodyslam earthquake blizzard; chansey softboiled icebeam",
+      seed);
+  const MCTS::Input input{battle, durations, PKMN::result(battle)};
+  network.fill_cache(input.battle);
+
+  // a few states along a random line, evaluated together and one by one
+  struct Leaf {
+    MCTS::Input input;
+    std::vector<pkmn_choice> p1_choices;
+    std::vector<pkmn_choice> p2_choices;
+    std::array<float, 9> p1_logits;
+    std::array<float, 9> p2_logits;
+  };
+  std::vector<Leaf> leaves;
+  auto options = PKMN::options();
+  for (auto state = input; leaves.size() < 8;) {
+    if (pkmn_result_type(state.result)) {
+      break;
+    }
+    auto [p1_choices, p2_choices] = PKMN::choices(state.battle, state.result);
+    leaves.push_back({state, p1_choices, p2_choices});
+    state.result = PKMN::update(
+        state.battle, p1_choices[device.random_int(p1_choices.size())],
+        p2_choices[device.random_int(p2_choices.size())], options);
+  }
+  std::vector<NN::Battle::BatchEntry> entries;
+  for (auto &leaf : leaves) {
+    entries.push_back({&leaf.input.battle, &leaf.input.durations,
+                       static_cast<int>(leaf.p1_choices.size()),
+                       static_cast<int>(leaf.p2_choices.size()),
+                       leaf.p1_choices.data(), leaf.p2_choices.data(),
+                       leaf.p1_logits.data(), leaf.p2_logits.data(), 0});
+  }
+  network.value_policy_inference(std::span{entries});
+  for (size_t i = 0; i < leaves.size(); ++i) {
+    const auto &[state, choices_1, choices_2, logits_1, logits_2] = leaves[i];
+    std::array<float, 9> p1_logits;
+    std::array<float, 9> p2_logits;
+    const float value = network.value_policy_inference(
+        state.battle, state.durations, choices_1.size(), choices_2.size(),
+        choices_1.data(), choices_2.data(), p1_logits.data(),
+        p2_logits.data());
+    check(std::abs(value - entries[i].value) <= tol,
+          "batch leaves: values differ");
+    for (size_t j = 0; j < choices_1.size(); ++j) {
+      check(std::abs(p1_logits[j] - logits_1[j]) <= tol,
+            "batch leaves: p1 logits differ");
+    }
+    for (size_t j = 0; j < choices_2.size(); ++j) {
+      check(std::abs(p2_logits[j] - logits_2[j]) <= tol,
+            "batch leaves: p2 logits differ");
+    }
+  }
+
+  // searches with and without batching visit different states, so only the
+  // entries in both tables are compared
+  using Table = MCTS::Table<PUCB::JointBandit>;
+  const PUCB::Bandit::Params params{.c = 1};
+  const auto search = [&](const size_t batch_size) {
+    // same hasher seeds, so states get the same keys
+    mt19937 table_device{seed};
+    Table table{table_device, 1};
+    MCTS::Search<> s{};
+    s.batch_size = batch_size;
+    s.run(device, size_t{1} << 10, params, table, network, input);
+    return table;
+  };
+  const auto single = search(1);
+  const auto batched = search(16);
+  size_t compared = 0;
+  for (size_t b = 0; b < single.buckets.size(); ++b) {
+    const auto &tags = batched.buckets[b].tags;
+    for (size_t i = 0; i < Table::bucket_size; ++i) {
+      const auto tag = single.buckets[b].tags[i];
+      const size_t j = std::find(tags.begin(), tags.end(), tag) - tags.begin();
+      if (!tag || j == Table::bucket_size) {
+        continue;
+      }
+      const auto &x = single.slots[b * Table::bucket_size + i];
+      const auto &y = batched.slots[b * Table::bucket_size + j];
+      if (!x.is_init() || !y.is_init()) {
+        continue;
+      }
+      ++compared;
+      for (auto a = 0; a < x.p1.k; ++a) {
+        check(std::abs(x.p1.priors[a] - y.p1.priors[a]) <= tol,
+              "batch leaves: p1 priors differ");
+      }
+      for (auto a = 0; a < x.p2.k; ++a) {
+        check(std::abs(x.p2.priors[a] - y.p2.priors[a]) <= tol,
+              "batch leaves: p2 priors differ");
+      }
+    }
+  }
+  check(compared > 1, "batch leaves: no common entries");
+}
+
+// a saved heap loads to the same tree or table, which an agent with another
+// bandit or table size refuses to search
+void heap_round_trip() {
+  const uint64_t seed = std::random_device{}();
+  mt19937 device{seed};
+  auto [battle, durations] = Parse::parse_battle(
+      "starmie surf thunderbolt recover | snorlax bodyslam earthquake", seed);
+  const MCTS::Input input{battle, durations, PKMN::result(battle)};
+  const auto path = (std::filesystem::temp_directory_path() /
+                     ("search-test-heap-" + std::to_string(seed)))
+                        .string();
+  const auto contents = [&path] {
+    std::ifstream file{path, std::ios::binary};
+    return std::string{std::istreambuf_iterator<char>{file}, {}};
+  };
+
+  for (const bool table : {false, true}) {
+    auto params = RuntimeSearch::AgentParams{
+        .budget = "256", .bandit = "ucb-1.0", .eval = "mc", .table_mb = 1};
+    params.table = table;
+    RuntimeSearch::Agent agent{params};
+    RuntimeSearch::Heap heap{};
+    RuntimeSearch::run(device, input, heap, agent);
+    check(heap.save(path), "heap round trip: could not save");
+    const auto saved = contents();
+
+    RuntimeSearch::Heap loaded{};
+    check(loaded.load(path), "heap round trip: could not load");
+    check(loaded.type() == heap.type(), "heap round trip: type differs");
+    if (!table) {
+      using Tree = MCTS::Tree<UCB::JointBandit>;
+      const auto &a = std::get<Tree>(heap.data);
+      const auto &b = std::get<Tree>(loaded.data);
+      check(a.visits == b.visits &&
+                !std::memcmp(&a.stats, &b.stats, sizeof(a.stats)),
+            "heap round trip: root stats differ");
+    }
+    check(loaded.save(path) && contents() == saved,
+          "heap round trip: contents differ");
+
+    const auto refused = [&](const RuntimeSearch::AgentParams &other) {
+      RuntimeSearch::Agent other_agent{other};
+      try {
+        RuntimeSearch::run(device, input, loaded, other_agent);
+      } catch (const std::exception &) {
+        return true;
+      }
+      return false;
+    };
+    auto other = params;
+    other.bandit = "exp3-1.0-0.1";
+    check(refused(other), "heap round trip: searched with another bandit");
+    if (table) {
+      other = params;
+      other.table_mb = 4;
+      check(refused(other), "heap round trip: searched with another size");
+    }
+
+    // a different version
+    auto bad = saved;
+    ++bad[8];
+    std::ofstream{path, std::ios::binary} << bad;
+    check(!loaded.load(path) && loaded.empty(),
+          "heap round trip: loaded a bad header");
+  }
+  std::filesystem::remove(path);
+}
+
+// workers of a parallel search share one table, which is reported once
+void shared_table_output() {
+  const uint64_t seed = std::random_device{}();
+  mt19937 device{seed};
+  auto [battle, durations] = Parse::parse_battle(
+      "starmie surf thunderbolt recover | snorlax bodyslam earthquake", seed);
+  const MCTS::Input input{battle, durations, PKMN::result(battle)};
+  RuntimeSearch::Agent agent{RuntimeSearch::AgentParams{.budget = "256",
+                                                        .bandit = "ucb-1.0",
+                                                        .eval = "mc",
+                                                        .table = true,
+                                                        .table_mb = 1,
+                                                        .threads = 4}};
+  RuntimeSearch::Heap heap{};
+  const auto output = RuntimeSearch::run(device, input, heap, agent);
+  const auto &table = std::get<MCTS::Table<UCB::JointBandit>>(heap.data);
+  check(output.iterations == 256, "shared table output: iterations differ");
+  check(output.nodes == 0 && output.bytes == table.bytes(),
+        "shared table output: bytes differ");
+}
+
+// the vector ucb argmax picks the same arm as a scalar loop that keeps the
+// first of equal values, for every k, with stale arms past k and with ties and
+// zero visit arms made likely by drawing from a few values
+void ucb_argmax_scalar() {
+  mt19937 device{std::random_device{}()};
+  for (int t = 0; t < 1 << 16; ++t) {
+    const uint8_t k = 2 + device.random_int(8);
+    std::array<float, 9> scores, bonus;
+    std::array<uint32_t, 9> visits;
+    const float e = .5f * device.random_int(3);
+    const bool priors = device.random_int(2);
+    for (int i = 0; i < 9; ++i) {
+      scores[i] = .5f + .5f * device.random_int(3);
+      visits[i] = device.random_int(3);
+      bonus[i] = priors ? e * device.random_int(2) : e;
+    }
+    uint8_t expected = 0;
+    float max = -std::numeric_limits<float>::infinity();
+    for (uint8_t i = 0; i < k; ++i) {
+      const float a = (bonus[i] + scores[i]) / visits[i];
+      if (a > max) {
+        max = a;
+        expected = i;
+      }
+    }
+    const auto index = ucb_argmax(scores.data(), visits.data(),
+                                  _mm256_loadu_ps(bonus.data()), bonus[8], k);
+    check(index == expected, "ucb argmax: picked " + std::to_string(index) +
+                                 " instead of " + std::to_string(expected) +
+                                 " with k = " + std::to_string(k));
+  }
+}
+
+// the vector exp3 policy is within tol of a double precision softmax over k
+// arms with -inf padding, and it is a distribution even for huge gain gaps
+void exp3_policy_accuracy() {
+  constexpr double tol = 1e-5;
+  constexpr float inf = std::numeric_limits<float>::infinity();
+  mt19937 device{std::random_device{}()};
+  const auto compare = [&](const std::array<float, 9> &gains, const int k,
+                           const float gamma, const float alpha) {
+    const float eta = gamma / k;
+    const float delta = alpha / k;
+    std::array<float, 9> policy;
+    exp3_policy(policy, gains, eta, 1 - alpha, delta);
+
+    const double max = *std::max_element(gains.begin(), gains.begin() + k);
+    std::array<double, 9> expected{};
+    double sum = 0;
+    for (int i = 0; i < k; ++i) {
+      expected[i] = std::exp((double{gains[i]} - max) * eta);
+      sum += expected[i];
+    }
+    double total = 0;
+    for (int i = 0; i < k; ++i) {
+      expected[i] = (1 - alpha) * expected[i] / sum + delta;
+      check(policy[i] >= 0, "exp3 policy: negative probability");
+      check(std::abs(policy[i] - expected[i]) <= tol,
+            "exp3 policy: differs from std::exp by " +
+                std::to_string(std::abs(policy[i] - expected[i])));
+      total += policy[i];
+    }
+    check(std::abs(total - 1) <= tol, "exp3 policy: does not sum to 1");
+  };
+
+  for (int k = 2; k <= 9; ++k) {
+    for (const float gamma : {.01f, .1f, 1.f, 10.f}) {
+      for (const float alpha : {0.f, .05f, .5f}) {
+        for (const float range : {1.f, 100.f, 1e4f}) {
+          std::array<float, 9> gains;
+          gains.fill(-inf);
+          for (int i = 0; i < k; ++i) {
+            gains[i] = range * (2 * device.uniform_float() - 1);
+          }
+          compare(gains, k, gamma, alpha);
+        }
+        // one arm far ahead, so the others underflow to exactly 0
+        std::array<float, 9> gains;
+        gains.fill(-inf);
+        for (int i = 0; i < k; ++i) {
+          gains[i] = -1e30f;
+        }
+        gains[device.random_int(k)] = 0;
+        compare(gains, k, gamma, alpha);
+        // ties
+        std::fill(gains.begin(), gains.begin() + k, 1e30f);
+        compare(gains, k, gamma, alpha);
+      }
+    }
+  }
+}
+
+// a compact ucb bandit settles on the best of some fixed arm values, an update
+// and a virtual loss and update agree, and the visits are halved before they
+// overflow but not while a virtual loss is pending. the contextual ones pick
+// the prior's arm before any update
+template <typename Bandit> void compact_bandit(const std::string &name) {
+  constexpr bool contextual =
+      requires(Bandit bandit) { bandit.softmax_logits({}, nullptr); };
+  mt19937 device{std::random_device{}()};
+  const typename Bandit::Params params{.c = 1};
+  constexpr std::array<float, 4> values{.2, .4, .8, .3};
+  Bandit bandit;
+  typename Bandit::Outcome outcome;
+
+  if constexpr (contextual) {
+    constexpr std::array<float, 4> logits{0, 0, 0, 2};
+    bandit.init(4);
+    bandit.softmax_logits(params, logits.data());
+    bandit.select(device, params, outcome);
+    check(outcome.index == 3, name + ": did not pick the prior's arm");
+    constexpr std::array<float, 4> uniform{};
+    bandit.softmax_logits(params, uniform.data());
+  } else {
+    bandit.init(4);
+  }
+  for (int t = 0; t < 1 << 12; ++t) {
+    bandit.select(device, params, outcome);
+    outcome.value = values[outcome.index];
+    bandit.update(outcome);
+  }
+  const auto best =
+      std::max_element(bandit.visits.begin(), bandit.visits.begin() + 4) -
+      bandit.visits.begin();
+  check(best == 2, name + ": did not settle on the best arm");
+  check(std::abs(bandit.mean(2) - values[2]) < 1e-3,
+        name + ": mean is not the arm value");
+
+  auto other = bandit;
+  outcome = {.value = .6, .index = 1};
+  bandit.update(outcome);
+  other.virtual_loss(outcome);
+  other.virtual_update(outcome);
+  check(bandit.visits[1] == other.visits[1] &&
+            std::abs(bandit.mean(1) - other.mean(1)) < 1e-5,
+        name + ": virtual loss and update differ from an update");
+
+  bandit.init(2);
+  outcome = {.value = 1, .index = 0};
+  for (int t = 0; t < 1 << 17; ++t) {
+    bandit.update(outcome);
+  }
+  check(bandit.n == uint32_t(bandit.visits[0]) + bandit.visits[1] &&
+            bandit.visits[0] > bandit.visits[1],
+        name + ": visits overflowed");
+
+  // the halving waits for a pending virtual loss, which virtual_update then
+  // undoes as if it had been an update
+  bandit.init(2);
+  auto updated = bandit;
+  const typename Bandit::Outcome pending{.value = .75, .index = 1};
+  bandit.virtual_loss(pending);
+  updated.update(pending);
+  for (int t = 0; t < 1 << 17; ++t) {
+    bandit.update(outcome);
+    updated.update(outcome);
+  }
+  check(bandit.visits[0] == Bandit::max_visits,
+        name + ": halved with a pending virtual loss");
+  bandit.virtual_update(pending);
+  check(std::abs(bandit.mean(1) - updated.mean(1)) < 1e-5,
+        name + ": virtual loss not undone across a halving");
+  bandit.update(outcome);
+  check(bandit.visits[0] < Bandit::max_visits &&
+            bandit.n == uint32_t(bandit.visits[0]) + bandit.visits[1],
+        name + ": did not halve after the virtual update");
+}
+
+void compact_bandits() {
+  compact_bandit<CUCB::Bandit>("cucb");
+  compact_bandit<CPUCB::Bandit>("cpucb");
+}
+
+// regret matching settles on the best of some fixed arm values, and the
+// predictive version starts from the policy of its priors
+template <typename Bandit> void regret_bandit(const std::string &name) {
+  constexpr bool contextual =
+      requires(Bandit bandit) { bandit.softmax_logits({}, nullptr); };
+  mt19937 device{std::random_device{}()};
+  typename Bandit::Params params{};
+  params.gamma = .1;
+  params.one_minus_gamma = .9;
+  if constexpr (contextual) {
+    params.prior_weight = 1;
+  }
+  constexpr std::array<float, 4> values{.2, .4, .8, .3};
+  Bandit bandit;
+  typename Bandit::Outcome outcome;
+  bandit.init(4);
+
+  if constexpr (contextual) {
+    constexpr std::array<float, 4> logits{0, 0, 0, 2};
+    bandit.softmax_logits(params, logits.data());
+    std::array<int, 4> counts{};
+    for (int t = 0; t < 1 << 12; ++t) {
+      bandit.select(device, params, outcome);
+      ++counts[outcome.index];
+    }
+    check(std::max_element(counts.begin(), counts.end()) - counts.begin() == 3,
+          name + ": did not follow the priors");
+    bandit.init(4);
+  }
+  std::array<int, 4> counts{};
+  for (int t = 0; t < 1 << 12; ++t) {
+    bandit.select(device, params, outcome);
+    check(std::abs(outcome.prob - (params.gamma / 4 + params.one_minus_gamma *
+                                                          outcome.policy)) <
+              1e-5,
+          name + ": prob is not the explored policy");
+    ++counts[outcome.index];
+    outcome.value = values[outcome.index];
+    bandit.update(outcome);
+  }
+  check(counts[2] > (1 << 11), name + ": did not settle on the best arm");
+  for (int i = 0; i < 4; ++i) {
+    check(bandit.regrets[i] >= 0, name + ": negative regret");
+  }
+}
+
+void regret_bandits() {
+  regret_bandit<RM::Bandit>("rm");
+  regret_bandit<PRM::Bandit>("prm");
+}
+
 void run_tests(const auto &args) {
   confusion_duration(args);
   sleep(args);
+  table_pins();
+  table_replacement();
+  nash_solvers();
+  batch_leaves();
+  heap_round_trip();
+  shared_table_output();
+  ucb_argmax_scalar();
+  exp3_policy_accuracy();
+  compact_bandits();
+  regret_bandits();
 }
 
 int main(int argc, char **argv) {
@@ -3,10 +3,16 @@
 #include <search/mcts.h>
 #include <util/strings.h>
 
+#include <algorithm>
+#include <array>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
+#include <functional>
+#include <optional>
 #include <thread>
+#include <type_traits>
+#include <utility>
 
 #include <fcntl.h>
 #include <sys/file.h>
@@ -18,12 +24,6 @@ bool Heap::empty() const noexcept {
   return std::holds_alternative<std::monostate>(data);
 }
 
-template <typename T>
-auto both(Heap &heap) -> std::pair<MCTS::Node<T> *, MCTS::Table<T> *> {
-  return {std::get_if<MCTS::Node<T>>(&heap.data),
-          std::get_if<MCTS::Table<T>>(&heap.data)};
-}
-
 bool Heap::update(uint8_t i, uint8_t j, const MCTS::Obs &obs) {
   const auto lambda = [&](auto &node) {
     using T = std::remove_cvref_t<decltype(node)>;
@@ -34,16 +34,15 @@ bool Heap::update(uint8_t i, uint8_t j, const MCTS::Obs &obs) {
         if (!node.stats.is_init()) {
           return false;
         }
-        auto child = node.children.find({i, j, obs});
-        if (child == node.children.end()) {
+        if (!node.reroot({i, j, obs})) {
           node = {};
           return false;
-        } else {
-          std::swap(node, child->second);
-          return true;
         }
+        node.compact();
+        return true;
       } else {
         static_assert(TypeTraits::is_table<T>);
+        node.age();
         return true;
       }
     }
@@ -57,6 +56,77 @@ std::string Heap::type() const noexcept {
       data);
 }
 
+namespace {
+constexpr char heap_magic[8] = "oakheap";
+// bumped whenever the tree, table or stats layout changes
+constexpr uint64_t heap_version = 3;
+} // namespace
+
+bool Heap::save(const std::string &path) const {
+  std::ofstream file{path, std::ios::binary};
+  const uint64_t index = data.index();
+  const auto name = type();
+  const uint64_t length = name.size();
+  file.write(heap_magic, sizeof(heap_magic));
+  file.write(reinterpret_cast<const char *>(&heap_version),
+             sizeof(heap_version));
+  file.write(reinterpret_cast<const char *>(&index), sizeof(index));
+  file.write(reinterpret_cast<const char *>(&length), sizeof(length));
+  file.write(name.data(), length);
+  std::visit(
+      [&file](const auto &heap) {
+        using T = std::remove_cvref_t<decltype(heap)>;
+        if constexpr (!std::is_same_v<T, std::monostate>) {
+          heap.write(file);
+        }
+      },
+      data);
+  return static_cast<bool>(file);
+}
+
+bool Heap::load(const std::string &path) {
+  data = {};
+  std::ifstream file{path, std::ios::binary};
+  char magic[sizeof(heap_magic)];
+  uint64_t version, index, length;
+  if (!file.read(magic, sizeof(magic)) ||
+      !std::equal(magic, magic + sizeof(magic), heap_magic) ||
+      !file.read(reinterpret_cast<char *>(&version), sizeof(version)) ||
+      version != heap_version ||
+      !file.read(reinterpret_cast<char *>(&index), sizeof(index)) ||
+      index >= std::variant_size_v<BanditVariant> ||
+      !file.read(reinterpret_cast<char *>(&length), sizeof(length)) ||
+      length > 1 << 12) {
+    return false;
+  }
+  std::string name(length, '\0');
+  if (!file.read(name.data(), length)) {
+    return false;
+  }
+  // emplace the alternative with that index
+  bool success = true;
+  [&]<size_t... I>(std::index_sequence<I...>) {
+    (
+        [&] {
+          using T = std::variant_alternative_t<I, BanditVariant>;
+          if (index == I) {
+            if constexpr (std::is_same_v<T, std::monostate>) {
+              data = {};
+            } else {
+              success = data.emplace<I>().read(file);
+            }
+          }
+        }(),
+        ...);
+  }(std::make_index_sequence<std::variant_size_v<BanditVariant>>{});
+  // the index alone would accept a file from a build with other bandits
+  if (!success || type() != name) {
+    data = {};
+    return false;
+  }
+  return true;
+}
+
 // Agent
 
 void Agent::initialize_network(const pkmn_gen1_battle &b) {
@@ -147,80 +217,186 @@ void Agent::initialize_network(const pkmn_gen1_battle &b) {
   }
 }
 
-MCTS::Output run(mt19937 &device, const MCTS::Input &input, Heap &heap_variant,
-                 Agent &agent, MCTS::Output output, bool *const flag) {
-
-  const auto parse_eval_and_search = [&](const auto dur, const auto &params,
-                                         auto &heap) {
-    MCTS::Search s{};
-    if (agent.is_monte_carlo()) {
-      MCTS::MonteCarlo model{};
-      return s.run(device, dur, params, heap, model, input, output);
-    } else if (agent.is_foul_play()) {
-      PokeEngine::Eval model{};
-      return s.run(device, dur, params, heap, model, input, output);
+// damage rolls a search can clamp to. 39 is every roll, so no clamping at
+// that depth
+constexpr std::array<size_t, 5> runtime_rolls{1, 2, 3, 20, 39};
+
+// sets the rolls of a search from "<root>-<other>" or "<both>". empty keeps
+// the MCTS::default_search rolls
+void parse_rolls(auto &s, const std::string &rolls) {
+  if (rolls.empty()) {
+    return;
+  }
+  const auto rolls_split = Parse::split(rolls, '-');
+  if (rolls_split.size() > 2) {
+    throw std::runtime_error{"Could not parse rolls: " + rolls};
+  }
+  const auto parse = [&rolls](const std::string &word) -> size_t {
+    const auto n = std::stoull(word);
+    if (std::find(runtime_rolls.begin(), runtime_rolls.end(), n) ==
+        runtime_rolls.end()) {
+      throw std::runtime_error{"Unsupported rolls: " + rolls +
+                               ". Each must be 1, 2, 3, 20 or 39"};
+    }
+    return n;
+  };
+  s.root_rolls = parse(rolls_split[0]);
+  s.other_rolls = parse(rolls_split.back());
+}
+
+// mc[-uniform|-greedy][-t<turns>][-n<rollouts>]
+MCTS::MonteCarlo parse_monte_carlo(const std::string &eval) {
+  MCTS::MonteCarlo model{};
+  if (!eval.starts_with("mc-")) {
+    return model;
+  }
+  const auto split = Parse::split(eval, '-');
+  for (size_t i = 1; i < split.size(); ++i) {
+    const auto &word = split[i];
+    if (word == "uniform") {
+      model.policy = MCTS::MonteCarlo::Policy::uniform;
+    } else if (word == "greedy") {
+      model.policy = MCTS::MonteCarlo::Policy::greedy;
+    } else if (word.size() > 1 && word[0] == 't') {
+      model.turns = std::stoull(word.substr(1));
+    } else if (word.size() > 1 && word[0] == 'n') {
+      model.rollouts = std::max(std::stoull(word.substr(1)), 1ULL);
+    } else {
+      throw std::runtime_error{"Could not parse Monte Carlo eval: " + eval};
+    }
+  }
+  return model;
+}
+
+MCTS::Obs Agent::root_obs(const pkmn_gen1_battle &battle,
+                          const pkmn_gen1_chance_durations &durations,
+                          const pkmn_choice c1, const pkmn_choice c2) const {
+  MCTS::Search<> s{};
+  parse_rolls(s, rolls);
+  return s.root_obs(battle, durations, c1, c2);
+}
+
+bool Agent::is_compiled() {
+  if (!search || (compiled_network != network_ptr.get())) {
+    return false;
+  }
+  // the budget is parsed per search and the beta samples are passed to it
+  compiled_params.budget = budget;
+  compiled_params.beta_samples = beta_samples;
+  return compiled_params == static_cast<const AgentParams &>(*this);
+}
+
+void Agent::compile() {
+
+  // the search for a configured Search, bandit params and heap/eval types.
+  // networks are held by reference, the other evals by value. the eval
+  // copies of parallel workers live as long as the search
+  const auto make_search = [this](auto s, const auto &params, auto heap_tag,
+                                  auto model) -> Search {
+    using Data = typename decltype(heap_tag)::type;
+    using Eval = std::unwrap_reference_t<decltype(model)>;
+    return [s, params, model, clones = std::vector<Eval>{}, threads = threads,
+            table_mb = table_mb](mt19937 &device, const MCTS::Input &input,
+                                 Heap &heap_variant, const Budget budget,
+                                 const size_t beta_n,
+                                 MCTS::Output output) mutable {
+      auto &heap = heap_variant.data;
+      if (heap_variant.empty()) {
+        if constexpr (TypeTraits::is_table<Data>) {
+          heap = Data{device, table_mb};
+        } else {
+          heap = Data{};
+        }
+      } else if (!std::holds_alternative<Data>(heap)) {
+        throw std::runtime_error{"RuntimeSearch: Bad Heap access. Expecting " +
+                                 std::string{typeid(Data).name()}};
+      } else if constexpr (TypeTraits::is_table<Data>) {
+        // a loaded table must have the size this agent would make
+        const auto n = std::get<Data>(heap).buckets.size();
+        if (n != Data::bucket_count(table_mb)) {
+          throw std::runtime_error{
+              "RuntimeSearch: Table has " + std::to_string(n) +
+              " buckets, expecting " +
+              std::to_string(Data::bucket_count(table_mb))};
+        }
+      }
+      Eval &eval = model;
+      s.beta_n = beta_n;
+      return std::visit(
+          [&](const auto b) {
+            if (threads > 1) {
+              return s.run_parallel(threads, device, b, params,
+                                    std::get<Data>(heap), eval, clones, input,
+                                    output);
+            }
+            return s.run(device, b, params, std::get<Data>(heap), eval, input,
+                         output);
+          },
+          budget);
+    };
+  };
+
+  const auto parse_eval = [&](const auto &params, auto heap_tag) -> Search {
+    MCTS::Search<> s{};
+    parse_rolls(s, rolls);
+    s.batch_size = batch_size;
+    s.max_bytes = (tree_mb << 20) / std::max(threads, size_t{1});
+    s.nash_tol = nash_tol;
+    if (!early_stop.empty()) {
+      const auto early_stop_split = Parse::split(early_stop, '-');
+      if (early_stop_split.size() != 3) {
+        throw std::runtime_error{"Could not parse early stop: " + early_stop};
+      }
+      s.early_stop = {std::stoull(early_stop_split[0]),
+                      std::stoull(early_stop_split[1]),
+                      std::stof(early_stop_split[2])};
+    }
+    if (is_monte_carlo()) {
+      return make_search(s, params, heap_tag, parse_monte_carlo(eval));
+    } else if (is_foul_play()) {
+      return make_search(s, params, heap_tag, PokeEngine::Eval{});
     } else {
-      if (!agent.network_ptr) {
-        agent.initialize_network(input.battle);
+      if (!network_ptr) {
+        throw std::runtime_error{"Agent: network is not initialized: " + eval};
       }
       if (auto network =
-              dynamic_cast<NN::Battle::Network *>(agent.network_ptr.get())) {
-        return s.run(device, dur, params, heap, *network, input, output);
+              dynamic_cast<NN::Battle::Network *>(network_ptr.get())) {
+        return make_search(s, params, heap_tag, std::ref(*network));
       } else if (auto network = dynamic_cast<NN::Battle::NetworkClamped *>(
-                     agent.network_ptr.get())) {
-        return s.run(device, dur, params, heap, *network, input, output);
+                     network_ptr.get())) {
+        return make_search(s, params, heap_tag, std::ref(*network));
       }
-      {
-        const auto [id, hd, vd, pd] = agent.network_ptr->shape();
-        auto q_network_ptr = NN::Battle::visit_quantized_network(
-            id, hd, vd, pd,
-            [&](auto &net) {
-              output = s.run(device, dur, params, heap, net, input, output);
-            },
-            std::move(agent.network_ptr));
-        if (q_network_ptr) {
-          agent.network_ptr = std::move(q_network_ptr);
-        }
-        return output;
+      Search result{};
+      const auto [id, hd, vd, pd] = network_ptr->shape();
+      auto q_network_ptr = NN::Battle::visit_quantized_network(
+          id, hd, vd, pd,
+          [&](auto &net) {
+            result = make_search(s, params, heap_tag, std::ref(net));
+          },
+          std::move(network_ptr));
+      if (q_network_ptr) {
+        network_ptr = std::move(q_network_ptr);
       }
+      return result;
     }
   };
 
-  const auto parse_heap_and_search = [&](const auto dur, const auto &params,
-                                         const auto &both) {
-    const auto [node_ptr, table_ptr] = both;
-    using Node = std::remove_cvref_t<decltype(*node_ptr)>;
-    using Table = std::remove_cvref_t<decltype(*table_ptr)>;
-    auto &heap = heap_variant.data;
-    if (agent.table) {
-      if (heap_variant.empty()) {
-        heap = Table{};
-        return parse_eval_and_search(dur, params, std::get<Table>(heap));
-      } else if (!table_ptr) {
-        throw std::runtime_error{"RuntimeSearch: Bad Heap access. Expecting " +
-                                 std::string{typeid(Table).name()}};
-      }
-      return parse_eval_and_search(dur, params, std::get<Table>(heap));
+  const auto parse_heap = [&](const auto &params, auto bandit_tag) {
+    using T = typename decltype(bandit_tag)::type;
+    if (table) {
+      return parse_eval(params, std::type_identity<MCTS::Table<T>>{});
     } else {
-      if (heap_variant.empty()) {
-        heap = Node{};
-        return parse_eval_and_search(dur, params, std::get<Node>(heap));
-      } else if (!node_ptr) {
-        throw std::runtime_error{"RuntimeSearch: Bad Heap access. Expecting " +
-                                 std::string{typeid(Node).name()}};
-      }
-      return parse_eval_and_search(dur, params, std::get<Node>(heap));
+      return parse_eval(params, std::type_identity<MCTS::Tree<T>>{});
     }
   };
 
-  const auto parse_matrix_ucb_and_search = [&](auto dur, auto &bandit_params,
-                                               const auto &both) {
-    const auto &matrix_ucb = agent.matrix_ucb;
+  const auto parse_matrix_ucb = [&](auto &bandit_params, auto bandit_tag) {
     if (!matrix_ucb.empty()) {
-      const auto matrix_ucb_split = Parse::split(agent.matrix_ucb, '-');
-      if (matrix_ucb_split.size() != 4) {
+      const auto matrix_ucb_split = Parse::split(matrix_ucb, '-');
+      if (matrix_ucb_split.size() != 4 &&
+          !(matrix_ucb_split.size() == 5 && matrix_ucb_split[4] == "async")) {
         throw std::runtime_error{"Could not parse MatrixUCB name: " +
-                                 agent.matrix_ucb};
+                                 matrix_ucb};
       }
       MCTS::MatrixUCBParams<std::remove_cvref_t<decltype(bandit_params)>>
           matrix_ucb_params{bandit_params};
@@ -228,21 +404,21 @@ MCTS::Output run(mt19937 &device, const MCTS::Input &input, Heap &heap_variant,
       matrix_ucb_params.interval = std::stoull(matrix_ucb_split[1]);
       matrix_ucb_params.minimum = std::stoull(matrix_ucb_split[2]);
       matrix_ucb_params.c = std::stof(matrix_ucb_split[3]);
-      return parse_heap_and_search(dur, matrix_ucb_params, both);
+      matrix_ucb_params.async = matrix_ucb_split.size() == 5;
+      return parse_heap(matrix_ucb_params, bandit_tag);
     } else {
-      return parse_heap_and_search(dur, bandit_params, both);
+      return parse_heap(bandit_params, bandit_tag);
     }
   };
 
-  const auto parse_bandit_and_search = [&](auto dur) {
-    const auto bandit_split = Parse::split(agent.bandit, '-');
+  const auto parse_bandit = [&]() {
+    const auto bandit_split = Parse::split(bandit, '-');
     if (bandit_split.size() < 2) {
-      throw std::runtime_error("Could not parse bandit string: " +
-                               agent.bandit);
+      throw std::runtime_error("Could not parse bandit string: " + bandit);
     }
 
-    const auto check_for_priors = [&agent]() {
-      if (agent.is_monte_carlo() || agent.is_foul_play()) {
+    const auto check_for_priors = [this]() {
+      if (is_monte_carlo() || is_foul_play()) {
         throw std::runtime_error{"Contextual bandit specified with eval that "
                                  "does not produce policy priors."};
       }
@@ -252,17 +428,35 @@ MCTS::Output run(mt19937 &device, const MCTS::Input &input, Heap &heap_variant,
     const float f1 = std::stof(bandit_split[1]);
     if (name == "ucb") {
       UCB::Bandit::Params params{.c = f1};
-      return parse_matrix_ucb_and_search(dur, params,
-                                         both<UCB::JointBandit>(heap_variant));
+      return parse_matrix_ucb(params, std::type_identity<UCB::JointBandit>{});
     } else if (name == "ucb1") {
       UCB1::Bandit::Params params{.c = f1};
-      return parse_matrix_ucb_and_search(dur, params,
-                                         both<UCB1::JointBandit>(heap_variant));
+      return parse_matrix_ucb(params, std::type_identity<UCB1::JointBandit>{});
     } else if (name == "pucb") {
       check_for_priors();
       PUCB::Bandit::Params params{.c = f1};
-      return parse_matrix_ucb_and_search(dur, params,
-                                         both<PUCB::JointBandit>(heap_variant));
+      return parse_matrix_ucb(params, std::type_identity<PUCB::JointBandit>{});
+    } else if (name == "cucb") {
+      CUCB::Bandit::Params params{.c = f1};
+      return parse_matrix_ucb(params, std::type_identity<CUCB::JointBandit>{});
+    } else if (name == "cpucb") {
+      check_for_priors();
+      CPUCB::Bandit::Params params{.c = f1};
+      return parse_matrix_ucb(params,
+                              std::type_identity<CPUCB::JointBandit>{});
+    } else if (name == "rm") {
+      RM::Bandit::Params params{.gamma = f1, .one_minus_gamma = (1 - f1)};
+      return parse_matrix_ucb(params, std::type_identity<RM::JointBandit>{});
+    } else if (name == "prm") {
+      check_for_priors();
+      float prior_weight = 1;
+      if (bandit_split.size() >= 3) {
+        prior_weight = std::stof(bandit_split[2]);
+      }
+      PRM::Bandit::Params params{.gamma = f1,
+                                 .one_minus_gamma = (1 - f1),
+                                 .prior_weight = prior_weight};
+      return parse_matrix_ucb(params, std::type_identity<PRM::JointBandit>{});
     }
 
     float alpha = .05;
@@ -274,42 +468,69 @@ MCTS::Output run(mt19937 &device, const MCTS::Input &input, Heap &heap_variant,
                                   .one_minus_gamma = (1 - f1),
                                   .alpha = alpha,
                                   .one_minus_alpha = (1 - alpha)};
-      return parse_matrix_ucb_and_search(dur, params,
-                                         both<Exp3::JointBandit>(heap_variant));
+      return parse_matrix_ucb(params, std::type_identity<Exp3::JointBandit>{});
     } else if (name == "pexp3") {
       check_for_priors();
       PExp3::Bandit::Params params{.gamma = f1,
                                    .one_minus_gamma = (1 - f1),
                                    .alpha = alpha,
                                    .one_minus_alpha = (1 - alpha)};
-      return parse_matrix_ucb_and_search(
-          dur, params, both<PExp3::JointBandit>(heap_variant));
+      return parse_matrix_ucb(params, std::type_identity<PExp3::JointBandit>{});
     } else {
       throw std::runtime_error("Could not parse bandit string: " + name);
     }
   };
 
-  const auto parse_budget_and_search = [&]() {
-    if (flag != nullptr) {
-      return parse_bandit_and_search(flag);
-    }
-    const auto pos = agent.budget.find_first_not_of("0123456789");
-    size_t number = std::stoll(agent.budget.substr(0, pos));
-    std::string unit =
-        (pos == std::string::npos) ? "" : agent.budget.substr(pos);
+  search = parse_bandit();
+  compiled_params = *this;
+  compiled_network = network_ptr.get();
+}
+
+Agent::Budget Agent::parse_budget(std::atomic<bool> *const flag) {
+  if (flag != nullptr) {
+    return flag;
+  }
+  if (parsed_budget.first.empty() || (budget != parsed_budget.first)) {
+    const auto pos = budget.find_first_not_of("0123456789");
+    size_t number = std::stoll(budget.substr(0, pos));
+    std::string unit = (pos == std::string::npos) ? "" : budget.substr(pos);
     if (unit.empty()) {
-      return parse_bandit_and_search(number);
+      parsed_budget.second = number;
     } else if (unit == "ms" || unit == "millisec" || unit == "milliseconds") {
-      return parse_bandit_and_search(std::chrono::milliseconds{number});
+      parsed_budget.second = std::chrono::milliseconds{number};
     } else if (unit == "s" || unit == "sec" || unit == "seconds") {
-      return parse_bandit_and_search(std::chrono::seconds{number});
+      parsed_budget.second = std::chrono::seconds{number};
     } else {
       throw std::runtime_error("Invalid search duration specification: " +
-                               agent.budget);
+                               budget);
     }
-  };
+    parsed_budget.first = budget;
+  }
+  if (const auto *iterations = std::get_if<size_t>(&parsed_budget.second)) {
+    return *iterations;
+  }
+  // time budgets are searched as deadlines, capped by the agent's
+  auto time_point = MCTS::Clock::now() +
+                    std::get<MCTS::Clock::duration>(parsed_budget.second);
+  if (deadline) {
+    time_point = std::min(time_point, *deadline);
+  }
+  return time_point;
+}
 
-  return parse_budget_and_search();
+MCTS::Output run(mt19937 &device, const MCTS::Input &input, Heap &heap_variant,
+                 Agent &agent, MCTS::Output output,
+                 std::atomic<bool> *const flag) {
+
+  // before the budget is parsed so loading is not counted against it
+  if (agent.is_network() && !agent.network_ptr) {
+    agent.initialize_network(input.battle);
+  }
+  if (!agent.is_compiled()) {
+    agent.compile();
+  }
+  return agent.search(device, input, heap_variant, agent.parse_budget(flag),
+                      agent.beta_samples, std::move(output));
 }
 
-} // namespace RuntimeSearch
\ No newline at end of file
+} // namespace RuntimeSearch
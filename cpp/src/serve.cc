@@ -0,0 +1,328 @@
+#include <util/argparse.h>
+#include <util/parse.h>
+#include <util/random.h>
+#include <util/search.h>
+#include <util/strings.h>
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Search daemon. Clients connect to a Unix socket and send one request per
+// line, "[<budget>\t]<battle-string>". Each request gets one reply, a line of
+// json or, with --binary, a status byte followed by the raw MCTS::Output (0)
+// or an error line (1). Connections are served by a pool of workers that keep
+// their agent (and network) and heap between requests. The network file is
+// read once and the workers copy it. Request budgets are capped by
+// --max-iterations and --max-ms
+
+struct ProgramArgs : public BenchmarkArgs {
+  std::optional<uint64_t> &seed = kwarg("seed", "Global program seed");
+  std::string &socket_path =
+      kwarg("socket", "Path of the Unix socket").set_default("/tmp/oak.sock");
+  size_t &workers =
+      kwarg("workers", "Number of connections served in parallel")
+          .set_default(std::max(1u, std::thread::hardware_concurrency()));
+  bool &binary =
+      flag("binary", "Reply with raw MCTS::Output bytes instead of json");
+  size_t &max_iterations =
+      kwarg("max-iterations", "Largest iteration budget a request may use")
+          .set_default(1 << 24);
+  size_t &max_ms =
+      kwarg("max-ms", "Largest time budget in milliseconds a request may use")
+          .set_default(60000);
+};
+
+namespace RuntimeData {
+std::atomic<bool> terminated{};
+std::mutex mutex{};
+std::condition_variable cv{};
+std::queue<int> connections{};
+// the first network loaded, which the other workers clone
+std::mutex network_mutex{};
+std::unique_ptr<NN::Battle::NetworkBase> network{};
+} // namespace RuntimeData
+
+void handle_terminate(int signal) { RuntimeData::terminated = true; }
+
+bool write_all(const int fd, const char *data, size_t size) {
+  while (size > 0) {
+    const auto n = send(fd, data, size, MSG_NOSIGNAL);
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+MCTS::Input parse_input(const std::string &line, uint64_t seed) {
+  auto [battle, durations] = Parse::parse_battle(line, seed);
+  MCTS::randomize_hidden_variables(battle, durations);
+  return {battle, durations, PKMN::result(battle)};
+}
+
+struct Worker {
+  // far longer than any battle string. longer lines drop the connection
+  static constexpr size_t max_line = 1 << 16;
+  // how often in microseconds a worker waiting on a client checks for
+  // termination
+  static constexpr suseconds_t poll_us = 200000;
+
+  const ProgramArgs &args;
+  RuntimeSearch::Agent agent;
+  RuntimeSearch::Heap heap;
+  mt19937 device;
+
+  std::string reply(const std::string &line) {
+    const auto tab = line.find('\t');
+    agent.budget = (tab == std::string::npos)
+                       ? args.budget.value_or(std::to_string(1 << 12))
+                       : line.substr(0, tab);
+    check_budget();
+    const auto input = parse_input(
+        (tab == std::string::npos) ? line : line.substr(tab + 1),
+        device.uniform_64());
+    if (agent.is_network() && !agent.network_ptr) {
+      std::lock_guard lock{RuntimeData::network_mutex};
+      if (RuntimeData::network) {
+        agent.network_ptr = RuntimeData::network->clone();
+      } else {
+        agent.initialize_network(input.battle);
+        RuntimeData::network = agent.network_ptr->clone();
+      }
+    }
+    // the cache of a warm network still holds the last request's teams
+    if (agent.network_ptr) {
+      agent.network_ptr->fill_cache(input.battle);
+    }
+    // trees are specific to their root but tables can be kept, only aged
+    if (agent.table) {
+      heap.update(0, 0, {});
+    } else {
+      heap = {};
+    }
+    const auto output = RuntimeSearch::run(device, input, heap, agent);
+    // the values are averages over the iterations
+    if (!output.iterations) {
+      throw std::runtime_error{"Budget ran no iterations: " + agent.budget};
+    }
+    if (args.binary) {
+      std::string data(1 + sizeof(MCTS::Output), '\0');
+      std::memcpy(data.data() + 1, &output, sizeof(MCTS::Output));
+      return data;
+    }
+    const auto [p1_labels, p2_labels] =
+        PKMN::choice_labels(input.battle, input.result);
+    return MCTS::output_json(output, p1_labels, p2_labels) + '\n';
+  }
+
+  // so that one request can't hold a worker indefinitely
+  void check_budget() {
+    const auto budget = agent.parse_budget(nullptr);
+    if (const auto *iterations = std::get_if<size_t>(&budget)) {
+      if (*iterations > args.max_iterations) {
+        throw std::runtime_error{"Budget is over the maximum of " +
+                                 std::to_string(args.max_iterations) +
+                                 " iterations: " + agent.budget};
+      }
+    } else if (std::get<MCTS::Clock::time_point>(budget) - MCTS::Clock::now() >
+               std::chrono::milliseconds{args.max_ms}) {
+      throw std::runtime_error{"Budget is over the maximum of " +
+                               std::to_string(args.max_ms) +
+                               "ms: " + agent.budget};
+    }
+  }
+
+  std::string error(const std::string &what) const {
+    if (args.binary) {
+      return '\1' + what + '\n';
+    }
+    std::string escaped{};
+    for (const char c : what) {
+      if (c == '"' || c == '\\') {
+        escaped += '\\';
+      }
+      escaped += c;
+    }
+    return "{\"error\":\"" + escaped + "\"}\n";
+  }
+
+  // replies to every line until the client disconnects or the server stops
+  void serve(const int fd) {
+    const timeval timeout{.tv_sec = 0, .tv_usec = poll_us};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    std::string buffer{};
+    char chunk[1 << 12];
+    while (!RuntimeData::terminated) {
+      const auto n = recv(fd, chunk, sizeof(chunk), 0);
+      if ((n < 0) &&
+          (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        continue;
+      }
+      if (n <= 0) {
+        return;
+      }
+      buffer.append(chunk, n);
+      size_t begin = 0;
+      for (auto end = buffer.find('\n'); end != std::string::npos;
+           end = buffer.find('\n', begin)) {
+        if (end - begin > max_line) {
+          break;
+        }
+        auto line = buffer.substr(begin, end - begin);
+        begin = end + 1;
+        if (!line.empty() && line.back() == '\r') {
+          line.pop_back();
+        }
+        if (line.empty()) {
+          continue;
+        }
+        std::string data;
+        try {
+          data = reply(line);
+        } catch (const std::exception &e) {
+          data = error(e.what());
+        }
+        if (!write_all(fd, data.data(), data.size())) {
+          return;
+        }
+      }
+      if (buffer.size() - begin > max_line) {
+        const auto data = error("Line is longer than " +
+                                std::to_string(max_line) + " bytes");
+        write_all(fd, data.data(), data.size());
+        return;
+      }
+      buffer.erase(0, begin);
+    }
+  }
+};
+
+void work(const ProgramArgs &args, const RuntimeSearch::AgentParams &params,
+          const std::mt19937::result_type seed) {
+  Worker worker{args, RuntimeSearch::Agent{params}, {}, mt19937{seed}};
+  while (true) {
+    int fd;
+    {
+      std::unique_lock lock{RuntimeData::mutex};
+      RuntimeData::cv.wait(lock, [] {
+        return RuntimeData::terminated || !RuntimeData::connections.empty();
+      });
+      if (RuntimeData::terminated) {
+        return;
+      }
+      fd = RuntimeData::connections.front();
+      RuntimeData::connections.pop();
+    }
+    worker.serve(fd);
+    close(fd);
+  }
+}
+
+int main(int argc, char **argv) {
+
+  auto args = argparse::parse<ProgramArgs>(argc, argv);
+
+  const auto agent_params = RuntimeSearch::AgentParams{
+      .budget = args.budget.value_or(std::to_string(1 << 12)),
+      .bandit = args.bandit.value_or("ucb-1.0"),
+      .eval = args.eval.value_or("mc"),
+      .matrix_ucb = args.matrix_ucb.value_or(""),
+      .discrete = args.use_discrete,
+      .table = args.use_table,
+      .table_mb = args.table_mb.value_or(64),
+      .tree_mb = args.tree_mb.value_or(0),
+      .threads = args.search_threads.value_or(1),
+      .batch_size = args.batch_size.value_or(1),
+      .early_stop = args.search_stop.value_or(""),
+      .nash_tol = args.nash_tol.value_or(0),
+      .rolls = args.rolls.value_or("")};
+
+  if (!args.seed.has_value()) {
+    args.seed.emplace(std::random_device{}());
+  }
+
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (args.socket_path.size() >= sizeof(address.sun_path)) {
+    std::cerr << "Socket path is too long: " << args.socket_path << std::endl;
+    return 1;
+  }
+  std::strcpy(address.sun_path, args.socket_path.c_str());
+
+  const int server = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(args.socket_path.c_str());
+  if (server < 0 ||
+      bind(server, reinterpret_cast<sockaddr *>(&address), sizeof(address)) ||
+      listen(server, SOMAXCONN)) {
+    std::perror("Could not open socket");
+    return 1;
+  }
+
+  // no SA_RESTART, so that accept returns when the server is stopped
+  struct sigaction action{};
+  action.sa_handler = handle_terminate;
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+
+  // the workers inherit a mask without the signals, so that they interrupt
+  // accept on this thread
+  sigset_t signals{};
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+  mt19937 device{args.seed.value()};
+  std::vector<std::thread> threads{};
+  for (size_t t = 0; t < args.workers; ++t) {
+    threads.emplace_back(work, std::cref(args), std::cref(agent_params),
+                         device.random_seed());
+  }
+  pthread_sigmask(SIG_UNBLOCK, &signals, nullptr);
+  std::cout << "Serving on " << args.socket_path << " with " << args.workers
+            << " workers." << std::endl;
+
+  while (!RuntimeData::terminated) {
+    const int fd = accept(server, nullptr, nullptr);
+    if (fd < 0) {
+      continue;
+    }
+    {
+      std::lock_guard lock{RuntimeData::mutex};
+      RuntimeData::connections.push(fd);
+    }
+    RuntimeData::cv.notify_one();
+  }
+
+  // the workers read args and agent_params, so they are joined first. a
+  // running search ends within its capped budget
+  {
+    std::lock_guard lock{RuntimeData::mutex};
+    RuntimeData::cv.notify_all();
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  while (!RuntimeData::connections.empty()) {
+    close(RuntimeData::connections.front());
+    RuntimeData::connections.pop();
+  }
+  close(server);
+  unlink(args.socket_path.c_str());
+  return 0;
+}
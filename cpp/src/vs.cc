@@ -44,6 +44,9 @@ struct ProgramArgs : public VsArgs {
             "Battles exceeding this many updates are dropped")
           .set_default(-1);
   int &print_interval = kwarg("print-interval", "Seconds").set_default(15);
+  std::optional<size_t> &move_ms =
+      kwarg("move-ms", "Time limit per move (ms) shared by a player's "
+                       "searches, including the 'after' ones");
 
   size_t &buffer_size =
       kwarg("buffer-size", "Size of battle buffer (Mb) before write")
@@ -164,7 +167,25 @@ void thread_fn(const ProgramArgs *args_ptr) {
             args.p1_matrix_ucb.or_else([&] { return args.matrix_ucb; })
                 .value_or(""),
         .discrete = args.use_discrete || args.p1_use_discrete,
-        .table = args.p1_use_table};
+        .table = args.p1_use_table,
+        .table_mb =
+            args.p1_table_mb.or_else([&] { return args.table_mb; })
+                .value_or(64),
+        .tree_mb = args.p1_tree_mb.or_else([&] { return args.tree_mb; })
+                       .value_or(0),
+        .threads =
+            args.p1_search_threads.or_else([&] { return args.search_threads; })
+                .value_or(1),
+        .batch_size =
+            args.p1_batch_size.or_else([&] { return args.batch_size; })
+                .value_or(1),
+        .early_stop =
+            args.p1_search_stop.or_else([&] { return args.search_stop; })
+                .value_or(""),
+        .nash_tol = args.p1_nash_tol.or_else([&] { return args.nash_tol; })
+                        .value_or(0),
+        .rolls = args.p1_rolls.or_else([&] { return args.rolls; })
+                     .value_or("")};
     auto p1_agent = RuntimeSearch::Agent{p1_agent_params};
     auto p1_agent_after = RuntimeSearch::Agent{p1_agent_params};
     p1_agent_after.budget = args.p1_budget_after.value_or("0");
@@ -176,6 +197,8 @@ void thread_fn(const ProgramArgs *args_ptr) {
                     .value_or(1),
         .min = args.p1_policy_min.or_else([&] { return args.policy_min; })
                    .value_or(0)};
+    p1_agent.beta_samples = p1_agent_after.beta_samples =
+        RuntimePolicy::beta_samples(p1_policy_options.mode);
 
     auto p2_agent_params = RuntimeSearch::AgentParams{
         .budget = args.p2_budget.or_else([&] { return args.budget; }).value(),
@@ -185,7 +208,25 @@ void thread_fn(const ProgramArgs *args_ptr) {
             args.p2_matrix_ucb.or_else([&] { return args.matrix_ucb; })
                 .value_or(""),
         .discrete = args.use_discrete || args.p2_use_discrete,
-        .table = args.p2_use_table};
+        .table = args.p2_use_table,
+        .table_mb =
+            args.p2_table_mb.or_else([&] { return args.table_mb; })
+                .value_or(64),
+        .tree_mb = args.p2_tree_mb.or_else([&] { return args.tree_mb; })
+                       .value_or(0),
+        .threads =
+            args.p2_search_threads.or_else([&] { return args.search_threads; })
+                .value_or(1),
+        .batch_size =
+            args.p2_batch_size.or_else([&] { return args.batch_size; })
+                .value_or(1),
+        .early_stop =
+            args.p2_search_stop.or_else([&] { return args.search_stop; })
+                .value_or(""),
+        .nash_tol = args.p2_nash_tol.or_else([&] { return args.nash_tol; })
+                        .value_or(0),
+        .rolls = args.p2_rolls.or_else([&] { return args.rolls; })
+                     .value_or("")};
     auto p2_agent = RuntimeSearch::Agent{p2_agent_params};
     auto p2_agent_after = RuntimeSearch::Agent{p2_agent_params};
     p2_agent_after.budget = args.p2_budget_after.value_or("0");
@@ -197,6 +238,8 @@ void thread_fn(const ProgramArgs *args_ptr) {
                     .value_or(1),
         .min = args.p2_policy_min.or_else([&] { return args.policy_min; })
                    .value_or(0)};
+    p2_agent.beta_samples = p2_agent_after.beta_samples =
+        RuntimePolicy::beta_samples(p2_policy_options.mode);
 
     const bool same_search =
         (p1_agent == p2_agent) && (p1_agent_after == p2_agent_after);
@@ -255,8 +298,18 @@ void thread_fn(const ProgramArgs *args_ptr) {
       int p1_index{}, p2_index{};
       p1_early_stop = 0;
       p2_early_stop = 0;
+      // start a player's move clock just before their first search
+      const auto set_deadline = [&args](auto &agent, auto &agent_after) {
+        if (args.move_ms) {
+          agent.deadline = MCTS::Clock::now() +
+                           std::chrono::milliseconds{*args.move_ms};
+          agent_after.deadline = agent.deadline;
+        }
+      };
+
       if (p1_choices.size() > 1) {
         RuntimeSearch::Heap heap{};
+        set_deadline(p1_agent, p1_agent_after);
         p1_output = RuntimeSearch::run(device, input, heap, p1_agent);
         p1_output =
             RuntimeSearch::run(device, input, heap, p1_agent_after, p1_output);
@@ -275,6 +328,7 @@ void thread_fn(const ProgramArgs *args_ptr) {
           p2_output = p1_output;
         } else {
           RuntimeSearch::Heap heap{};
+          set_deadline(p2_agent, p2_agent_after);
           p2_output = RuntimeSearch::run(device, input, heap, p2_agent);
           p2_output = RuntimeSearch::run(device, input, heap, p2_agent_after,
                                          p2_output);
@@ -18,6 +18,8 @@ def get_paths(directory):
         f"_bin/{directory}/vs",
         f"_bin/{directory}/chall",
         f"_bin/{directory}/benchmark",
+        f"_bin/{directory}/serve",
+        f"_bin/{directory}/bandit-benchmark",
     ]
 
 
@@ -26,6 +26,14 @@ def oak_search_test():
     _run_binary("search-test")
 
 
+def oak_serve():
+    _run_binary("serve")
+
+
+def oak_bandit_benchmark():
+    _run_binary("bandit-benchmark")
+
+
 def vs():
     _run_binary("vs")
 